@@ -0,0 +1,148 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Tiny microbenchmark harness. Each op is called with an iteration count,
+// calibrated until one call takes at least minSampleMs, then sampled
+// several times; the median ns per iteration is reported. Ops that process
+// a batch per iteration can pass itemsPerOp to also get a throughput figure.
+// Non-timing figures such as memory footprints are recorded with metric().
+namespace bench {
+
+template<typename T>
+inline void keep(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+inline void clobber() {
+    asm volatile("" : : : "memory");
+}
+
+struct Result {
+    std::string name;
+    long long iterations;
+    double nsPerOp;
+    double minNs;
+    double maxNs;
+    double itemsPerSec;
+};
+
+struct Metric {
+    std::string name;
+    double value;
+    std::string unit;
+};
+
+class Suite {
+    std::string module;
+    std::vector<Result> results;
+    std::vector<Metric> metrics;
+    std::string filter;
+    std::string jsonPath;
+    double minSampleMs;
+    int samples;
+    
+    static std::string escape(const std::string& s) {
+        std::string out;
+        for (char c : s) {
+            if (c == '"' || c == '\\') out += '\\';
+            out += c;
+        }
+        return out;
+    }
+    
+public:
+    Suite(const std::string& m, int argc, char** argv)
+        : module(m), minSampleMs(20), samples(5) {
+        for (int i = 1; i < argc; i++) {
+            std::string arg = argv[i];
+            if (arg == "--json" && i + 1 < argc) jsonPath = argv[++i];
+            else if (arg == "--filter" && i + 1 < argc) filter = argv[++i];
+            else if (arg == "--quick") { minSampleMs = 2; samples = 3; }
+        }
+    }
+    
+    template<typename Op>
+    void run(const std::string& name, Op op, double itemsPerOp = 0) {
+        if (!filter.empty() && name.find(filter) == std::string::npos) return;
+        
+        using clock = std::chrono::steady_clock;
+        long long iters = 1;
+        double ms;
+        while (true) {
+            auto start = clock::now();
+            op(iters);
+            ms = std::chrono::duration<double, std::milli>(clock::now() - start).count();
+            if (ms >= minSampleMs || iters >= (1LL << 40)) break;
+            iters *= ms < minSampleMs / 16 ? 8 : 2;
+        }
+        
+        // ops that take seconds per call get fewer samples
+        int count = ms > 500 ? std::min(samples, 3) : samples;
+        std::vector<double> ns;
+        for (int s = 0; s < count; s++) {
+            auto start = clock::now();
+            op(iters);
+            ns.push_back(std::chrono::duration<double, std::nano>(clock::now() - start).count() / iters);
+        }
+        std::sort(ns.begin(), ns.end());
+        double median = ns[ns.size() / 2];
+        double rate = itemsPerOp > 0 ? itemsPerOp * 1e9 / median : 0;
+        results.push_back({ name, iters, median, ns.front(), ns.back(), rate });
+        std::cerr << module << "/" << name << ": " << median << " ns/op";
+        if (rate > 0) std::cerr << ", " << rate / 1e6 << " M items/s";
+        std::cerr << std::endl;
+    }
+    
+    // Records a measured quantity where lower is better, e.g. bytes used.
+    void metric(const std::string& name, double value, const std::string& unit) {
+        if (!filter.empty() && name.find(filter) == std::string::npos) return;
+        metrics.push_back({ name, value, unit });
+        std::ostringstream text;
+        text.precision(12);
+        text << value;
+        std::cerr << module << "/" << name << ": " << text.str() << " " << unit << std::endl;
+    }
+    
+    int finish() const {
+        std::ostringstream json;
+        json.precision(12);
+        json << "{\n  \"module\": \"" << escape(module) << "\",\n  \"results\": [";
+        for (size_t i = 0; i < results.size(); i++) {
+            const Result& r = results[i];
+            json << (i ? ",\n" : "\n") << "    {\"name\": \"" << escape(r.name)
+                 << "\", \"iterations\": " << r.iterations << ", \"ns_per_op\": " << r.nsPerOp
+                 << ", \"min_ns\": " << r.minNs << ", \"max_ns\": " << r.maxNs;
+            if (r.itemsPerSec > 0) json << ", \"items_per_second\": " << r.itemsPerSec;
+            json << "}";
+        }
+        json << "\n  ],\n  \"metrics\": [";
+        for (size_t i = 0; i < metrics.size(); i++) {
+            const Metric& m = metrics[i];
+            json << (i ? ",\n" : "\n") << "    {\"name\": \"" << escape(m.name) << "\", \"value\": " << m.value
+                 << ", \"unit\": \"" << escape(m.unit) << "\"}";
+        }
+        json << "\n  ]\n}\n";
+        
+        if (jsonPath.empty()) {
+            std::cout << json.str();
+            return 0;
+        }
+        std::ofstream out(jsonPath);
+        if (!out) {
+            std::cerr << "Cannot write " << jsonPath << std::endl;
+            return 1;
+        }
+        out << json.str();
+        return 0;
+    }
+};
+
+}
\ No newline at end of file
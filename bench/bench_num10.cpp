@@ -0,0 +1,162 @@
+#include "bench/bench.h"
+#include "num10.cpp"
+#include <algorithm>
+#include <functional>
+
+int main(int argc, char* argv[]) {
+    bench::Suite suite("num10", argc, argv);
+    
+    vector<unique_ptr<Vehicle>> fleet;
+    for (int i = 0; i < 999; i++) {
+        if (i % 3 == 0) fleet.push_back(make_unique<Car>("Volvo", "XC90", 2022, 10.3, 5, 550.0));
+        else if (i % 3 == 1) fleet.push_back(make_unique<Truck>("MAZ", "6430", 2019, 4.8, 20000.0, i % 2));
+        else fleet.push_back(make_unique<Motorcycle>("IZH", "Planeta", 1990, 25.0, "two-stroke", false));
+    }
+    
+    suite.run("Vehicle::calculateRange", [&](long long n) {
+        double total = 0;
+        for (long long i = 0; i < n; i++) {
+            total += fleet[i % fleet.size()]->calculateRange(50.0);
+        }
+        bench::keep(total);
+    });
+    
+    suite.run("Vehicle::getDescription", [&](long long n) {
+        for (long long i = 0; i < n; i++) {
+            string d = fleet[i % fleet.size()]->getDescription();
+            bench::keep(d.size());
+        }
+    });
+    
+    // Range queries over a larger fleet with varied consumption: the virtual
+    // scan calls calculateRange on every vehicle, the index does a lookup.
+    vector<unique_ptr<Vehicle>> big;
+    for (int i = 0; i < 100000; i++) {
+        double fc = 4.0 + (i * 7919 % 1000) / 50.0;
+        if (i % 3 == 0) big.push_back(make_unique<Car>("Volvo", "XC90", 2022, fc, 5, 550.0));
+        else if (i % 3 == 1) big.push_back(make_unique<Truck>("MAZ", "6430", 2019, fc, 20000.0, i % 2));
+        else big.push_back(make_unique<Motorcycle>("IZH", "Planeta", 1990, fc, "two-stroke", false));
+    }
+    RangeIndex index(big);
+    
+    // about 2% of the fleet can cover 1100 km on 40 liters
+    const double distance = 1100, fuel = 40;
+    size_t feasible = 0;
+    for (const auto& v : big) feasible += v->calculateRange(fuel) >= distance;
+    if (index.canCover(distance, fuel).size() != feasible) {
+        cerr << "range index disagrees with the virtual scan" << endl;
+        return 1;
+    }
+    
+    suite.run("canCover/100K/scan", [&](long long n) {
+        for (long long i = 0; i < n; i++) {
+            vector<const Vehicle*> out;
+            for (const auto& v : big) {
+                if (v->calculateRange(fuel) >= distance) out.push_back(v.get());
+            }
+            bench::keep(out.size());
+        }
+    });
+    
+    suite.run("canCover/100K/index", [&](long long n) {
+        for (long long i = 0; i < n; i++) {
+            vector<const Vehicle*> out = index.canCover(distance, fuel);
+            bench::keep(out.size());
+        }
+    });
+    
+    suite.run("canCover/100K/trucks/scan", [&](long long n) {
+        for (long long i = 0; i < n; i++) {
+            vector<const Vehicle*> out;
+            for (const auto& v : big) {
+                if (v->getKind() == VehicleKind::Truck && v->calculateRange(fuel) >= 800) out.push_back(v.get());
+            }
+            bench::keep(out.size());
+        }
+    });
+    
+    suite.run("canCover/100K/trucks/index", [&](long long n) {
+        for (long long i = 0; i < n; i++) {
+            vector<const Vehicle*> out = index.canCover(800, fuel, VehicleKind::Truck);
+            bench::keep(out.size());
+        }
+    });
+    
+    suite.run("longestRange/100K/top10/scan", [&](long long n) {
+        vector<pair<double, const Vehicle*>> ranges(big.size());
+        for (long long i = 0; i < n; i++) {
+            for (size_t j = 0; j < big.size(); j++) ranges[j] = { big[j]->calculateRange(fuel), big[j].get() };
+            partial_sort(ranges.begin(), ranges.begin() + 10, ranges.end(), greater<pair<double, const Vehicle*>>());
+            bench::keep(ranges[0].second);
+        }
+    });
+    
+    suite.run("longestRange/100K/top10/index", [&](long long n) {
+        for (long long i = 0; i < n; i++) {
+            vector<const Vehicle*> out = index.longestRange(10);
+            bench::keep(out[0]);
+        }
+    });
+    
+    suite.run("RangeIndex::remove+add", [&](long long n) {
+        for (long long i = 0; i < n; i++) {
+            const Vehicle& v = *big[i % big.size()];
+            index.remove(v);
+            index.add(v);
+        }
+    });
+    
+    // Startup: building 1M vehicles through the constructors versus opening a
+    // snapshot of the same fleet. The file is in the page cache after the
+    // first run, so this measures the mapping, not the disk.
+    const size_t fleetSize = 1000000;
+    auto build = [&] {
+        vector<unique_ptr<Vehicle>> out;
+        out.reserve(fleetSize);
+        for (size_t i = 0; i < fleetSize; i++) {
+            double fc = 4.0 + (i * 7919 % 1000) / 50.0;
+            if (i % 3 == 0) out.push_back(make_unique<Car>("Volvo", "XC90", 2022, fc, 5, 550.0));
+            else if (i % 3 == 1) out.push_back(make_unique<Truck>("MAZ", "6430", 2019, fc, 20000.0, i % 2));
+            else out.push_back(make_unique<Motorcycle>("IZH", "Planeta", 1990, fc, "two-stroke", false));
+        }
+        return out;
+    };
+    const string path = "bench_fleet.bin";
+    FleetSnapshot::write(path, build());
+    
+    suite.run("load/1M/constructors", [&](long long n) {
+        for (long long i = 0; i < n; i++) {
+            vector<unique_ptr<Vehicle>> loaded = build();
+            bench::keep(loaded.size());
+        }
+    });
+    
+    suite.run("load/1M/snapshot/open", [&](long long n) {
+        for (long long i = 0; i < n; i++) {
+            FleetSnapshot snap(path);
+            bench::keep(snap.year(snap.size() - 1));
+        }
+    });
+    
+    suite.run("load/1M/snapshot/open+scan", [&](long long n) {
+        for (long long i = 0; i < n; i++) {
+            FleetSnapshot snap(path);
+            double total = 0;
+            for (size_t j = 0; j < snap.size(); j++) total += snap.kmPerLiter(j);
+            bench::keep(total);
+        }
+    });
+    
+    suite.run("load/1M/snapshot/materializeAll", [&](long long n) {
+        for (long long i = 0; i < n; i++) {
+            FleetSnapshot snap(path);
+            double total = 0;
+            for (size_t j = 0; j < snap.size(); j++) total += snap[j].getKmPerLiter();
+            bench::keep(total);
+        }
+    });
+    
+    remove(path.c_str());
+    
+    return suite.finish();
+}
\ No newline at end of file
@@ -0,0 +1,117 @@
+#include "bench/bench.h"
+#include "num11.cpp"
+
+int main(int argc, char* argv[]) {
+    bench::Suite suite("num11", argc, argv);
+    
+    // MagicSpell logs every lifecycle event; measure the copies, not the terminal
+    streambuf* console = cout.rdbuf(nullptr);
+    
+    {
+        MagicSpell source("Expecto patronum, a reasonably long incantation");
+        
+        suite.run("MagicSpell::copy", [&](long long n) {
+            for (long long i = 0; i < n; i++) {
+                MagicSpell copy(source);
+                bench::keep(copy);
+            }
+        });
+        
+        suite.run("MagicSpell::copyAssign", [&](long long n) {
+            MagicSpell target("x");
+            for (long long i = 0; i < n; i++) {
+                target = source;
+                bench::clobber();
+            }
+        });
+        
+        suite.run("MagicSpell::move", [&](long long n) {
+            MagicSpell a(source);
+            for (long long i = 0; i < n; i++) {
+                MagicSpell b(move(a));
+                a = move(b);
+                bench::clobber();
+            }
+        });
+    }
+    
+    // A million spells drawn from 20K distinct texts: per-instance heap copies
+    // versus handles into a SpellCatalog.
+    const size_t spells = 1000000, distinct = 20000;
+    vector<string> texts;
+    for (size_t i = 0; i < distinct; i++) {
+        texts.push_back("Incantation of the " + to_string(i * 2654435761u % 1000003) + "th circle");
+    }
+    
+    {
+        size_t payload = 0;
+        for (size_t i = 0; i < spells; i++) payload += texts[i % distinct].size() + 1;
+        SpellCatalog catalog;
+        for (const string& t : texts) catalog.intern(t.c_str());
+        // the owned figure leaves out per-block allocator overhead
+        suite.metric("memory/1M/owned", spells * sizeof(MagicSpell) + payload, "bytes");
+        suite.metric("memory/1M/catalog", spells * sizeof(MagicSpell) + catalog.bytes(), "bytes");
+    }
+    
+    suite.run("spells/1M/build/owned", [&](long long n) {
+        for (long long k = 0; k < n; k++) {
+            vector<MagicSpell> all;
+            all.reserve(spells);
+            for (size_t i = 0; i < spells; i++) all.emplace_back(texts[i % distinct].c_str());
+            bench::keep(all.size());
+        }
+    }, spells);
+    
+    suite.run("spells/1M/build/catalog", [&](long long n) {
+        for (long long k = 0; k < n; k++) {
+            SpellCatalog catalog;
+            vector<MagicSpell> all;
+            all.reserve(spells);
+            for (size_t i = 0; i < spells; i++) all.emplace_back(catalog, texts[i % distinct].c_str());
+            bench::keep(all.size());
+        }
+    }, spells);
+    
+    {
+        SpellCatalog catalog;
+        vector<MagicSpell> owned, shared;
+        owned.reserve(spells);
+        shared.reserve(spells);
+        for (size_t i = 0; i < spells; i++) {
+            owned.emplace_back(texts[i % distinct].c_str());
+            shared.emplace_back(catalog, texts[i % distinct].c_str());
+        }
+        
+        suite.run("spells/1M/copy/owned", [&](long long n) {
+            for (long long k = 0; k < n; k++) {
+                vector<MagicSpell> copy(owned);
+                bench::keep(copy.size());
+            }
+        }, spells);
+        
+        suite.run("spells/1M/copy/catalog", [&](long long n) {
+            for (long long k = 0; k < n; k++) {
+                vector<MagicSpell> copy(shared);
+                bench::keep(copy.size());
+            }
+        }, spells);
+        
+        // equal texts are 20K apart, so half the pairs match
+        auto countEqual = [&](const vector<MagicSpell>& all, long long n) {
+            size_t equal = 0;
+            for (long long k = 0; k < n; k++) {
+                for (size_t i = 0; i + distinct < spells; i += 2) {
+                    equal += all[i] == all[i + distinct];
+                    equal += all[i + 1] == all[i + distinct / 2];
+                }
+            }
+            bench::keep(equal);
+        };
+        
+        suite.run("spells/1M/equal/owned", [&](long long n) { countEqual(owned, n); }, spells - distinct);
+        suite.run("spells/1M/equal/catalog", [&](long long n) { countEqual(shared, n); }, spells - distinct);
+    }
+    
+    cout.rdbuf(console);
+    return suite.finish();
+}
\ No newline at end of file
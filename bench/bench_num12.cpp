@@ -0,0 +1,281 @@
+#include "bench/bench.h"
+#include "num12.cpp"
+#include <random>
+#include <cstdio>
+
+const char* storageName(Storage s) {
+    switch (s) {
+        case Storage::Heap: return "heap";
+        case Storage::Anonymous: return "anonymous";
+        case Storage::File: return "file";
+    }
+    return "?";
+}
+
+int main(int argc, char* argv[]) {
+    bench::Suite suite("num12", argc, argv);
+    
+    SafeArray arr(1 << 16);
+    const SafeArray& view = arr;
+    
+    suite.run("SafeArray::operator[]/read", [&](long long n) {
+        long long sum = 0;
+        for (long long i = 0; i < n; i++) {
+            sum += view[i & 0xFFFF];
+        }
+        bench::keep(sum);
+    });
+    
+    suite.run("SafeArray::operator[]/write", [&](long long n) {
+        for (long long i = 0; i < n; i++) {
+            arr[i & 0xFFFF] = i;
+        }
+        bench::clobber();
+    });
+    
+    suite.run("SafeArray::resize/heap", [&](long long n) {
+        SafeArray a(1024);
+        for (long long i = 0; i < n; i++) {
+            a.resize(i & 1 ? 1024 : 4096);
+        }
+    });
+    
+    suite.run("SafeArray::resize/anonymous", [&](long long n) {
+        SafeArray a(1024, Storage::Anonymous);
+        for (long long i = 0; i < n; i++) {
+            a.resize(i & 1 ? 1024 : 4096);
+        }
+    });
+    
+    // 16M counters under 4096: plain int layout versus 12-bit packed blocks
+    const int count = 1 << 24;
+    vector<int> plain(count);
+    mt19937 rng(12345);
+    for (int& v : plain) v = rng() % 4096;
+    PackedSafeArray packed(plain.data(), count);
+    const PackedSafeArray& packedView = packed;
+    suite.metric("memory/16M/int", (double)count * sizeof(int), "bytes");
+    suite.metric("memory/16M/packed", packed.bytes(), "bytes");
+    
+    suite.run("scan/16M/int", [&](long long n) {
+        for (long long k = 0; k < n; k++) {
+            long long sum = 0;
+            for (int i = 0; i < count; i++) sum += plain[i];
+            bench::keep(sum);
+        }
+    }, count);
+    
+    suite.run("scan/16M/packed", [&](long long n) {
+        for (long long k = 0; k < n; k++) {
+            bench::keep(packed.reduce(0LL, [](long long s, int x) { return s + x; }));
+        }
+    }, count);
+    
+    // output buffer allocated and faulted in once, outside the timed calls
+    vector<int> decoded(count);
+    suite.run("decode/16M/packed", [&](long long n) {
+        for (long long k = 0; k < n; k++) {
+            packed.copyTo(decoded.data());
+            bench::keep(decoded[count - 1]);
+        }
+    }, count);
+    
+    suite.run("encode/16M/packed", [&](long long n) {
+        for (long long k = 0; k < n; k++) {
+            packed.assign(plain.data());
+            bench::clobber();
+        }
+    }, count);
+    
+    // checked random access over the same 16M values
+    SafeArray big(count);
+    for (int i = 0; i < count; i++) big[i] = plain[i];
+    const SafeArray& bigView = big;
+    
+    suite.run("random/16M/read/int", [&](long long n) {
+        long long sum = 0;
+        for (long long i = 0; i < n; i++) {
+            sum += bigView[(i * 40503) & (count - 1)];
+        }
+        bench::keep(sum);
+    });
+    
+    suite.run("random/16M/read/packed", [&](long long n) {
+        long long sum = 0;
+        for (long long i = 0; i < n; i++) {
+            sum += packedView[(i * 40503) & (count - 1)];
+        }
+        bench::keep(sum);
+    });
+    
+    suite.run("random/16M/write/int", [&](long long n) {
+        for (long long i = 0; i < n; i++) {
+            big[(i * 40503) & (count - 1)] = i & 4095;
+        }
+        bench::clobber();
+    });
+    
+    suite.run("random/16M/write/packed", [&](long long n) {
+        for (long long i = 0; i < n; i++) {
+            packed[(i * 40503) & (count - 1)] = i & 4095;
+        }
+        bench::clobber();
+    });
+    
+    // Storage kinds: growing by doubling, first touch of fresh pages and a
+    // warm sequential read of 16M ints.
+    const char* path = "safearray_bench.bin";
+    Storage kinds[] = { Storage::Heap, Storage::Anonymous, Storage::File };
+    for (Storage s : kinds) {
+        string kind = storageName(s);
+        
+        suite.run("grow/1K-16M/" + kind, [&](long long n) {
+            for (long long k = 0; k < n; k++) {
+                {
+                    SafeArray a(1024, s, path);
+                    for (int size = 2048; size <= count; size *= 2) {
+                        a.resize(size);
+                        a.set(size - 1, size);
+                    }
+                }
+                remove(path);
+            }
+        });
+        
+        suite.run("firstTouch/16M/" + kind, [&](long long n) {
+            for (long long k = 0; k < n; k++) {
+                {
+                    SafeArray a(count, s, path);
+                    for (int i = 0; i < count; i += 1024) a.set(i, i);
+                }
+                remove(path);
+            }
+        }, count / 1024);
+        
+        SafeArray a(count, s, path);
+        for (int i = 0; i < count; i += 1024) a.set(i, i);
+        const SafeArray& warm = a;
+        suite.run("read/16M/" + kind, [&](long long n) {
+            for (long long k = 0; k < n; k++) {
+                long long sum = 0;
+                for (int i = 0; i < count; i++) sum += warm[i];
+                bench::keep(sum);
+            }
+        }, count);
+    }
+    remove(path);
+    
+    // Parallel algorithms against their std counterparts on 16M ints. Sort
+    // copies its input inside the timed call, the same for both.
+    SafeArray data(count);
+    vector<int> values(count);
+    for (int i = 0; i < count; i++) {
+        values[i] = rng() % 1000000;
+        data.set(i, values[i]);
+    }
+    const SafeArray& dataView = data;
+    int needle = values[count - 1];
+    long long expectedSum = accumulate(values.begin(), values.end(), 0LL);
+    long expectedPos = std::find(values.begin(), values.end(), needle) - values.begin();
+    auto plus = [](long long acc, long long x) { return acc + x; };
+    auto maxOf = [](int x, int y) { return max(x, y); };
+    auto flip = [](int x) { return x ^ 0x5555; };
+    
+    suite.run("sort/16M/std", [&](long long n) {
+        for (long long k = 0; k < n; k++) {
+            vector<int> v = values;
+            std::sort(v.begin(), v.end());
+            bench::keep(v[0]);
+        }
+    }, count);
+    suite.run("reduce/16M/std", [&](long long n) {
+        for (long long k = 0; k < n; k++) bench::keep(accumulate(values.begin(), values.end(), 0LL));
+    }, count);
+    vector<int> work = values;
+    suite.run("scan/16M/std", [&](long long n) {
+        for (long long k = 0; k < n; k++) {
+            inclusive_scan(work.begin(), work.end(), work.begin(), maxOf);
+            bench::clobber();
+        }
+    }, count);
+    suite.run("transform/16M/std", [&](long long n) {
+        for (long long k = 0; k < n; k++) {
+            std::transform(work.begin(), work.end(), work.begin(), flip);
+            bench::clobber();
+        }
+    }, count);
+    suite.run("find/16M/std", [&](long long n) {
+        for (long long k = 0; k < n; k++) bench::keep(std::find(values.begin(), values.end(), needle));
+    }, count);
+    
+    int maxThreads = ThreadPool::shared().size() + 1;
+    for (int t = 1; t <= maxThreads; t = t * 2 > maxThreads && t < maxThreads ? maxThreads : t * 2) {
+        SafeArray::setThreads(t);
+        string threads = "/" + to_string(t) + "t";
+        if (data.reduce(0LL, plus) != expectedSum || data.find(needle) != expectedPos) {
+            cerr << "SafeArray algorithms disagree with std on " << t << " thread(s)" << endl;
+            return 1;
+        }
+        
+        suite.run("sort/16M/SafeArray" + threads, [&](long long n) {
+            for (long long k = 0; k < n; k++) {
+                SafeArray a = data;
+                a.sort();
+                bench::keep(dataView[0]);
+            }
+        }, count);
+        suite.run("reduce/16M/SafeArray" + threads, [&](long long n) {
+            for (long long k = 0; k < n; k++) bench::keep(data.reduce(0LL, plus));
+        }, count);
+        SafeArray scratch = data;
+        suite.run("scan/16M/SafeArray" + threads, [&](long long n) {
+            for (long long k = 0; k < n; k++) {
+                scratch.inclusiveScan(maxOf);
+                bench::clobber();
+            }
+        }, count);
+        suite.run("transform/16M/SafeArray" + threads, [&](long long n) {
+            for (long long k = 0; k < n; k++) {
+                scratch.transform(flip);
+                bench::clobber();
+            }
+        }, count);
+        suite.run("find/16M/SafeArray" + threads, [&](long long n) {
+            for (long long k = 0; k < n; k++) bench::keep(data.find(needle));
+        }, count);
+    }
+    SafeArray::setThreads(0);
+    
+    // Snapshots of a 1M array into a ring of 4, with a write every tenth
+    // round: copy-on-write through set(), the same writes through
+    // operator[] (which leaks the buffer until the next fill), and forcing
+    // every snapshot to deep-copy.
+    const int snapshotSize = 1 << 20;
+    const char* snapshotNames[] = {"snapshot/1M/cow", "snapshot/1M/cow/operator[]", "snapshot/1M/deep"};
+    for (int mode = 0; mode < 3; mode++) {
+        SafeArray live(snapshotSize);
+        live.fill(1);
+        vector<SafeArray> history(4, live);
+        long long round = 0;
+        suite.run(snapshotNames[mode], [&](long long n) {
+            long long sum = 0;
+            for (long long k = 0; k < n; k++, round++) {
+                if (round % 10 == 0) {
+                    if (mode == 1) {
+                        live[round % snapshotSize] = (int)round;
+                    } else {
+                        live.set(round % snapshotSize, (int)round);
+                    }
+                }
+                SafeArray& snapshot = history[round % history.size()];
+                snapshot = live;
+                if (mode == 2) snapshot.set(0, 1);
+                const SafeArray& view = snapshot;
+                for (int i = 0; i < snapshotSize; i += snapshotSize / 16) sum += view[i];
+            }
+            bench::keep(sum);
+        });
+    }
+    
+    return suite.finish();
+}
\ No newline at end of file
@@ -0,0 +1,263 @@
+#include "bench/bench.h"
+#include "num15.cpp"
+#include <chrono>
+#include <random>
+
+template<typename T, int Capacity>
+class LockedStack {
+    mutex m;
+    Stack<T, Capacity> s;
+    
+public:
+    bool tryPush(const T& value) {
+        lock_guard<mutex> lock(m);
+        if (s.full()) return false;
+        s.push(value);
+        return true;
+    }
+    
+    bool tryPop(T& out) {
+        lock_guard<mutex> lock(m);
+        if (s.empty()) return false;
+        out = s.pop();
+        return true;
+    }
+};
+
+template<typename S>
+void runContention(S& stack, int threads, long long opsPerThread) {
+    vector<thread> pool;
+    for (int t = 0; t < threads; t++) {
+        pool.emplace_back([&stack, opsPerThread, t] {
+            int value;
+            for (long long i = 0; i < opsPerThread; i++) {
+                stack.tryPush((int)(t * opsPerThread + i));
+                stack.tryPop(value);
+            }
+        });
+    }
+    for (thread& th : pool) {
+        th.join();
+    }
+}
+
+struct Heavy {
+    string name;
+    vector<int> payload;
+    
+    Heavy() {}
+    Heavy(const string& n, int len) : name(n), payload(len, 7) {}
+};
+
+// the old Stack layout: every slot default-constructed up front
+template<typename T, int Capacity>
+struct EagerStack {
+    T data[Capacity];
+    int topIndex = -1;
+    
+    void push(const T& value) { data[++topIndex] = value; }
+    T pop() { return data[topIndex--]; }
+};
+
+struct Tree {
+    vector<int> firstChild;
+    
+    explicit Tree(int nodes) : firstChild(nodes + 1) {
+        mt19937 rng(7);
+        int next = 1;
+        for (int i = 0; i < nodes; i++) {
+            firstChild[i] = next;
+            int kids = rng() % 5;
+            next = min(nodes, next + kids);
+            if (next == i + 1 && next < nodes) next++;
+        }
+        firstChild[nodes] = nodes;
+    }
+};
+
+unsigned visitCost(int node) {
+    unsigned h = node;
+    for (int i = 0; i < 200; i++) {
+        h ^= h << 13;
+        h ^= h >> 17;
+        h ^= h << 5;
+    }
+    return h;
+}
+
+int main(int argc, char* argv[]) {
+    bench::Suite suite("num15", argc, argv);
+    
+    suite.run("Stack::push+pop", [&](long long n) {
+        Stack<int, 1024> s;
+        int sum = 0;
+        for (long long i = 0; i < n; i++) {
+            s.push(i);
+            if (s.full()) {
+                while (!s.empty()) sum += s.pop();
+            }
+        }
+        bench::keep(sum);
+    });
+    
+    suite.run("Stack::push+pop/string", [&](long long n) {
+        Stack<string, 64> s;
+        string value(40, 'x');
+        for (long long i = 0; i < n; i++) {
+            s.push(value);
+            if (s.full()) {
+                while (!s.empty()) bench::keep(s.pop().size());
+            }
+        }
+    });
+    
+    suite.run("HybridStack::push+pop", [&](long long n) {
+        HybridStack<int, 256> s;
+        int sum = 0;
+        for (long long i = 0; i < n; i++) {
+            s.push(i);
+            if (s.size() == 4096) {
+                while (!s.empty()) sum += s.pop();
+            }
+        }
+        bench::keep(sum);
+    });
+    
+    suite.run("ConcurrentStack::push+pop", [&](long long n) {
+        static ConcurrentStack<int, 1024> s;
+        int value = 0;
+        for (long long i = 0; i < n; i++) {
+            s.tryPush(i);
+            s.tryPop(value);
+        }
+        bench::keep(value);
+    });
+    
+    // push+pop pairs from 1-64 threads on a lock-free and a mutex stack;
+    // an iteration is one pair, shared out between the threads
+    for (int threads = 1; threads <= 64; threads *= 2) {
+        string suffix = "/" + to_string(threads) + "t";
+        suite.run("contention/ConcurrentStack" + suffix, [&](long long n) {
+            auto stack = make_unique<ConcurrentStack<int, 1024>>();
+            runContention(*stack, threads, max(1LL, n / threads));
+        });
+        suite.run("contention/LockedStack" + suffix, [&](long long n) {
+            auto stack = make_unique<LockedStack<int, 1024>>();
+            runContention(*stack, threads, max(1LL, n / threads));
+        });
+    }
+    
+    // 1024 heavy elements pushed and popped per iteration
+    const int heavyCount = 1024;
+    Heavy proto(string(200, 'x'), 64);
+    auto eager = make_unique<EagerStack<Heavy, heavyCount>>();
+    auto raw = make_unique<Stack<Heavy, heavyCount>>();
+    
+    suite.run("heavy/eager/copy", [&](long long n) {
+        for (long long k = 0; k < n; k++) {
+            for (int i = 0; i < heavyCount; i++) eager->push(proto);
+            while (eager->topIndex >= 0) bench::keep(eager->pop().payload.size());
+        }
+    }, heavyCount);
+    
+    suite.run("heavy/raw/copy", [&](long long n) {
+        for (long long k = 0; k < n; k++) {
+            for (int i = 0; i < heavyCount; i++) raw->push(proto);
+            while (!raw->empty()) bench::keep(raw->pop().payload.size());
+        }
+    }, heavyCount);
+    
+    suite.run("heavy/raw/emplace", [&](long long n) {
+        for (long long k = 0; k < n; k++) {
+            for (int i = 0; i < heavyCount; i++) raw->emplace(string(200, 'x'), 64);
+            while (!raw->empty()) bench::keep(raw->pop().payload.size());
+        }
+    }, heavyCount);
+    
+    // 1M-deep push/pop: a fixed Stack sized for the worst case versus a
+    // HybridStack that starts with 256 inline slots
+    const int depth = 1 << 20;
+    auto fixed = make_unique<Stack<int, depth>>();
+    HybridStack<int, 256> hybrid;
+    vector<int> frames(4096);
+    for (int i = 0; i < (int)frames.size(); i++) frames[i] = i;
+    suite.metric("deep/1M/Stack/footprint", sizeof(Stack<int, depth>), "bytes");
+    suite.metric("deep/1M/HybridStack/inline", sizeof(HybridStack<int, 256>), "bytes");
+    
+    long long fixedSum = 0, hybridSum = 0;
+    suite.run("deep/1M/Stack", [&](long long n) {
+        for (long long k = 0; k < n; k++) {
+            for (int i = 0; i < depth; i++) fixed->push(i);
+            while (!fixed->empty()) fixedSum += fixed->pop();
+        }
+    }, depth);
+    
+    suite.run("deep/1M/HybridStack", [&](long long n) {
+        for (long long k = 0; k < n; k++) {
+            for (int i = 0; i < depth; i++) hybrid.push(i);
+            while (!hybrid.empty()) hybridSum += hybrid.pop();
+        }
+    }, depth);
+    
+    suite.run("deep/1M/HybridStack/range4096", [&](long long n) {
+        for (long long k = 0; k < n; k++) {
+            for (int i = 0; i < depth; i += frames.size()) hybrid.pushRange(frames.data(), frames.size());
+            for (int i = 0; i < depth; i += frames.size()) hybrid.popRange(frames.data(), frames.size());
+        }
+        bench::keep(frames[0]);
+    }, depth);
+    
+    long long expectedRound = (long long)depth * (depth - 1) / 2;
+    if (fixedSum % expectedRound != 0 || hybridSum % expectedRound != 0) {
+        cerr << "deep push/pop sums are off" << endl;
+        return 1;
+    }
+    
+    // Depth-first visit of a random 1M-node tree: a plain Stack loop versus
+    // the work-stealing scheduler on 1..hardware threads
+    const int nodes = 1 << 20;
+    Tree tree(nodes);
+    unsigned expected = 0;
+    suite.run("tree/1M/Stack", [&](long long n) {
+        auto stack = make_unique<Stack<int, 1 << 16>>();
+        for (long long k = 0; k < n; k++) {
+            unsigned total = 0;
+            stack->push(0);
+            while (!stack->empty()) {
+                int node = stack->pop();
+                total += visitCost(node);
+                for (int c = tree.firstChild[node]; c < tree.firstChild[node + 1]; c++) {
+                    stack->push(c);
+                }
+            }
+            expected = total;
+        }
+    }, nodes);
+    
+    int maxThreads = max(2u, thread::hardware_concurrency());
+    for (int threads = 1; threads <= maxThreads; threads *= 2) {
+        TaskScheduler<int> scheduler(threads);
+        vector<unsigned> sums(threads * 16);
+        auto visit = [&](int node, TaskScheduler<int>::Worker& w) {
+            sums[w.id() * 16] += visitCost(node);
+            for (int c = tree.firstChild[node]; c < tree.firstChild[node + 1]; c++) {
+                w.spawn(c);
+            }
+        };
+        unsigned total = 0;
+        suite.run("tree/1M/scheduler/" + to_string(threads) + "t", [&](long long n) {
+            for (long long k = 0; k < n; k++) {
+                fill(sums.begin(), sums.end(), 0);
+                scheduler.run(0, visit);
+                total = 0;
+                for (int t = 0; t < threads; t++) total += sums[t * 16];
+            }
+        }, nodes);
+        if (total != expected) {
+            cerr << "scheduler traversal disagrees with the Stack loop" << endl;
+            return 1;
+        }
+    }
+    
+    return suite.finish();
+}
\ No newline at end of file
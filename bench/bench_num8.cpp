@@ -0,0 +1,109 @@
+#include "bench/bench.h"
+#include "num8.cpp"
+
+int main(int argc, char* argv[]) {
+    bench::Suite suite("num8", argc, argv);
+    
+    vector<Rectangle> rects;
+    for (int i = 0; i < 1024; i++) {
+        rects.push_back(Rectangle(1 + i % 7, 1 + i % 5, (i * 37) % 100, (i * 53) % 100));
+    }
+    
+    suite.run("Rectangle::Intersects", [&](long long n) {
+        int hits = 0;
+        for (long long i = 0; i < n; i++) {
+            hits += rects[i & 1023].Intersects(rects[(i * 7 + 3) & 1023]);
+        }
+        bench::keep(hits);
+    });
+    
+    suite.run("Rectangle::contains", [&](long long n) {
+        int hits = 0;
+        for (long long i = 0; i < n; i++) {
+            hits += rects[i & 1023].contains(Point(i % 100, (i * 3) % 100));
+        }
+        bench::keep(hits);
+    });
+    
+    // 64K rectangles on a 1 mm grid inside a 32 m world (fits int16_t)
+    const int layerSize = 1 << 16;
+    WorldFrame frame(0, 0, 0.001);
+    vector<Rectangle> plain;
+    QuantizedLayer<int32_t> layer32;
+    QuantizedLayer<int16_t> layer16;
+    unsigned seed = 1;
+    for (int i = 0; i < layerSize; i++) {
+        seed = seed * 1103515245u + 12345u;
+        double x = (seed >> 8) % 30000 * 0.001;
+        seed = seed * 1103515245u + 12345u;
+        double y = (seed >> 8) % 30000 * 0.001;
+        Rectangle r(0.5 + i % 100 * 0.01, 0.5 + i % 70 * 0.01, x, y);
+        plain.push_back(r);
+        layer32.add(Rect32(r, frame));
+        layer16.add(Rect16(r, frame));
+    }
+    Rectangle query(2, 2, 14, 14);
+    
+    suite.run("layer64K/Rectangle::Intersects", [&](long long n) {
+        for (long long k = 0; k < n; k++) {
+            size_t hits = 0;
+            for (const Rectangle& r : plain) hits += r.Intersects(query);
+            bench::keep(hits);
+        }
+    });
+    
+    suite.run("layer64K/int32", [&](long long n) {
+        Rect32 q(query, frame);
+        for (long long k = 0; k < n; k++) {
+            bench::keep(layer32.countIntersecting(q));
+        }
+    });
+    
+    suite.run("layer64K/int16", [&](long long n) {
+        Rect16 q(query, frame);
+        for (long long k = 0; k < n; k++) {
+            bench::keep(layer16.countIntersecting(q));
+        }
+    });
+    
+    // 1M heavily overlapping rectangles in a 1000 x 1000 world
+    vector<Rectangle> crowd;
+    for (int i = 0; i < (1 << 20); i++) {
+        seed = seed * 1103515245u + 12345u;
+        double x = (seed >> 8) % 100000 * 0.01;
+        seed = seed * 1103515245u + 12345u;
+        double y = (seed >> 8) % 100000 * 0.01;
+        crowd.push_back(Rectangle(1 + i % 13, 1 + i % 11, x, y));
+    }
+    double area = unionArea(crowd);
+    
+    suite.run("unionArea/1M", [&](long long n) {
+        for (long long k = 0; k < n; k++) bench::keep(unionArea(crowd));
+    });
+    
+    int threads = max(2u, thread::hardware_concurrency());
+    suite.run("unionAreaParallel/1M/" + to_string(threads) + "threads", [&](long long n) {
+        for (long long k = 0; k < n; k++) bench::keep(unionAreaParallel(crowd, threads));
+    });
+    
+    suite.run("coverageDepth/1M/1024x1024", [&](long long n) {
+        for (long long k = 0; k < n; k++) {
+            bench::keep(coverageDepth(crowd, Point(0, 0), 1000.0 / 1024, 1024, 1024).size());
+        }
+    });
+    
+    if (fabs(unionAreaParallel(crowd, threads) - area) > 1e-6 * area) {
+        cerr << "parallel union area disagrees with the sequential sweep" << endl;
+        return 1;
+    }
+    
+    size_t expected = 0;
+    for (const Rectangle& r : plain) expected += r.Intersects(query);
+    if (layer32.countIntersecting(Rect32(query, frame)) != expected ||
+        layer16.countIntersecting(Rect16(query, frame)) != expected) {
+        cerr << "quantized layer disagrees with Rectangle::Intersects" << endl;
+        return 1;
+    }
+    
+    return suite.finish();
+}
\ No newline at end of file
@@ -0,0 +1,135 @@
+#include "bench/bench.h"
+#include "num9.cpp"
+
+int main(int argc, char* argv[]) {
+    bench::Suite suite("num9", argc, argv);
+    
+    Vector3D a(1, 2, 3);
+    Vector3D b(4, 5, 6);
+    
+    suite.run("Vector3D::operator+", [&](long long n) {
+        for (long long i = 0; i < n; i++) {
+            Vector3D c = a + b;
+            bench::keep(c);
+        }
+    });
+    
+    suite.run("Vector3D::operator-", [&](long long n) {
+        for (long long i = 0; i < n; i++) {
+            Vector3D c = a - b;
+            bench::keep(c);
+        }
+    });
+    
+    suite.run("Vector3D::operator*", [&](long long n) {
+        for (long long i = 0; i < n; i++) {
+            Vector3D c = a * 2.5;
+            bench::keep(c);
+        }
+    });
+    
+    suite.run("Vector3D::dot", [&](long long n) {
+        for (long long i = 0; i < n; i++) {
+            bench::keep(Vector3D::dot(a, b));
+            bench::clobber();
+        }
+    });
+    
+    suite.run("Vector3D::getLength/cached", [&](long long n) {
+        for (long long i = 0; i < n; i++) {
+            bench::keep(a.getLength());
+            bench::clobber();
+        }
+    });
+    
+    suite.run("Vector3D::getLength/fresh", [&](long long n) {
+        for (long long i = 0; i < n; i++) {
+            Vector3D v(i, 2, 3);
+            bench::keep(v.getLength());
+        }
+    });
+    
+    suite.run("Vector3D::normalize", [&](long long n) {
+        for (long long i = 0; i < n; i++) {
+            Vector3D v = b.normalize();
+            bench::keep(v);
+        }
+    });
+    
+    suite.run("Vector3D::cross", [&](long long n) {
+        for (long long i = 0; i < n; i++) {
+            Vector3D c = Vector3D::cross(a, b);
+            bench::keep(c);
+        }
+    });
+    
+    Quaternion q = Quaternion::fromAxisAngle(Vector3D(1, 1, 0), 0.3);
+    Matrix4 m = Matrix4::translation(Vector3D(0.5, -1, 2)) * Matrix4(q.toMatrix());
+    
+    suite.run("Quaternion::rotate", [&](long long n) {
+        for (long long i = 0; i < n; i++) {
+            Vector3D r = q.rotate(a);
+            bench::keep(r);
+        }
+    });
+    
+    suite.run("Matrix4::transformPoint", [&](long long n) {
+        for (long long i = 0; i < n; i++) {
+            Vector3D r = m.transformPoint(a);
+            bench::keep(r);
+        }
+    });
+    
+    // Throughput over 1M points, reported in points per second. The
+    // transforms are rigid, so repeating them keeps the values bounded.
+    const int points = 1 << 20;
+    vector<Vector3D> cloud;
+    cloud.reserve(points);
+    for (int i = 0; i < points; i++) cloud.push_back(Vector3D(i % 1000, i % 777, i % 555));
+    
+    suite.run("transform/1M/single", [&](long long n) {
+        for (long long k = 0; k < n; k++) {
+            for (Vector3D& p : cloud) p = m.transformPoint(p);
+            bench::clobber();
+        }
+    }, points);
+    
+    suite.run("transform/1M/inplace/1thread", [&](long long n) {
+        for (long long k = 0; k < n; k++) {
+            transformPoints(m, cloud, 1);
+            bench::clobber();
+        }
+    }, points);
+    
+    suite.run("transform/1M/inplace/threads", [&](long long n) {
+        for (long long k = 0; k < n; k++) {
+            transformPoints(m, cloud);
+            bench::clobber();
+        }
+    }, points);
+    
+    PointBatch batch(cloud);
+    
+    suite.run("transform/1M/soa/1thread", [&](long long n) {
+        for (long long k = 0; k < n; k++) {
+            batch.transform(m, 1);
+            bench::clobber();
+        }
+    }, points);
+    
+    suite.run("transform/1M/soa/threads", [&](long long n) {
+        for (long long k = 0; k < n; k++) {
+            batch.transform(m);
+            bench::clobber();
+        }
+    }, points);
+    
+    suite.run("rotate/1M/soa/threads", [&](long long n) {
+        for (long long k = 0; k < n; k++) {
+            batch.rotate(q);
+            bench::clobber();
+        }
+    }, points);
+    
+    return suite.finish();
+}
\ No newline at end of file
@@ -0,0 +1,70 @@
+#!/usr/bin/env python3
+"""Compare benchmark JSON results against a saved baseline.
+
+usage: compare.py BASELINE CURRENT [--threshold PERCENT]
+
+BASELINE and CURRENT are result files or directories of them, as written
+by the bench_* programs with --json. Exits with status 1 when any
+benchmark got slower, or any metric (such as a memory footprint) got
+larger, by more than the threshold (default 10%).
+"""
+import argparse
+import glob
+import json
+import os
+import sys
+
+
+def load(path):
+    files = sorted(glob.glob(os.path.join(path, "*.json"))) if os.path.isdir(path) else [path]
+    results = {}
+    for name in files:
+        with open(name) as f:
+            data = json.load(f)
+        for r in data["results"]:
+            results[data["module"] + "/" + r["name"]] = r["ns_per_op"]
+        for m in data.get("metrics", []):
+            results["%s/%s [%s]" % (data["module"], m["name"], m["unit"])] = m["value"]
+    return results
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("baseline")
+    parser.add_argument("current")
+    parser.add_argument("--threshold", type=float, default=10.0)
+    args = parser.parse_args()
+
+    if not os.path.exists(args.baseline):
+        print("No baseline at %s; save one with the bench-baseline target" % args.baseline)
+        return 1
+    base = load(args.baseline)
+    cur = load(args.current)
+    limit = args.threshold / 100.0
+
+    regressions = 0
+    width = max([len(k) for k in cur] + [9])
+    print("%-*s %12s %12s %8s" % (width, "benchmark", "baseline", "current", "change"))
+    for key in sorted(cur):
+        if key not in base:
+            print("%-*s %12s %12.2f %8s" % (width, key, "-", cur[key], "new"))
+            continue
+        change = cur[key] / base[key] - 1.0 if base[key] > 0 else 0.0
+        mark = ""
+        if change > limit:
+            mark = "  REGRESSION"
+            regressions += 1
+        elif change < -limit:
+            mark = "  faster"
+        print("%-*s %12.2f %12.2f %+7.1f%%%s" % (width, key, base[key], cur[key], change * 100, mark))
+    for key in sorted(set(base) - set(cur)):
+        print("%-*s %12.2f %12s %8s" % (width, key, base[key], "-", "missing"))
+
+    if regressions:
+        print("%d benchmark(s) or metric(s) regressed by more than %g%%" % (regressions, args.threshold))
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -2,9 +2,28 @@
 #include <vector>
 #include <memory>
 #include <string>
+#include <set>
+#include <cstdint>
+#include <stdexcept>
+#include <cstring>
+#include <fstream>
+#include <unordered_map>
+#include "profiler.h"
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 using namespace std;
 
-class Vehicle {
+class FleetSnapshot;
+
+enum class VehicleKind { Car, Truck, Motorcycle };
+
+const int vehicleKindCount = 3;
+
+class Vehicle : prof::Tracked<Vehicle> {
 protected:
     string manufacturer;
     string model;
@@ -14,11 +33,18 @@ protected:
     Vehicle(string m, string mdl, int y, double fc) 
         : manufacturer(m), model(mdl), year(y), fuelConsumption(fc) {}
         
+    friend class FleetSnapshot;
+    
 public:
     virtual void startEngine() = 0;
     virtual void stopEngine() = 0;
     virtual string getDescription() const = 0;
     virtual double calculateRange(double fuelAmount) const = 0;
+    virtual VehicleKind getKind() const = 0;
+    
+    // Range is linear in fuel; this is the slope, so that
+    // calculateRange(f) == f * getKmPerLiter().
+    virtual double getKmPerLiter() const = 0;
     
     virtual ~Vehicle() = default;
 };
@@ -32,6 +58,8 @@ class Car : public Vehicle {
     int doors;
     double trunkCapacity;
     
+    friend class FleetSnapshot;
+    
 public:
     Car(string m, string mdl, int y, double fc, int d, double trunk) 
         : Vehicle(m, mdl, y, fc), doors(d), trunkCapacity(trunk) {}
@@ -50,7 +78,15 @@ public:
     }
     
     double calculateRange(double fuelAmount) const override {
-        return fuelAmount * fuelConsumption;
+        return fuelAmount * getKmPerLiter();
+    }
+    
+    VehicleKind getKind() const override {
+        return VehicleKind::Car;
+    }
+    
+    double getKmPerLiter() const override {
+        return fuelConsumption;
     }
     
     void openTrunk() {
@@ -62,7 +98,11 @@ class Truck : public Vehicle {
     double cargoCapacity;
     bool hasTrailer;
     
+    friend class FleetSnapshot;
+    
 public:
+    static constexpr double trailerFactor = 0.7;
+    
     Truck(string m, string mdl, int y, double fc, double cargo, bool trailer) 
         : Vehicle(m, mdl, y, fc), cargoCapacity(cargo), hasTrailer(trailer) {}
         
@@ -81,9 +121,17 @@ public:
     }
     
     double calculateRange(double fuelAmount) const override {
-        double range = fuelAmount * fuelConsumption;
-        if (hasTrailer) range *= 0.7;
-        return range;
+        return fuelAmount * getKmPerLiter();
+    }
+    
+    VehicleKind getKind() const override {
+        return VehicleKind::Truck;
+    }
+    
+    double getKmPerLiter() const override {
+        double rate = fuelConsumption;
+        if (hasTrailer) rate *= trailerFactor;
+        return rate;
     }
     
     void loadCargo() {
@@ -95,7 +143,11 @@ class Motorcycle : public Vehicle {
     string engineType;
     bool hasSideCar;
     
+    friend class FleetSnapshot;
+    
 public:
+    static constexpr double rangeFactor = 1.2;
+    
     Motorcycle(string m, string mdl, int y, double fc, string eType, bool sidecar) 
         : Vehicle(m, mdl, y, fc), engineType(eType), hasSideCar(sidecar) {}
         
@@ -114,7 +166,15 @@ public:
     }
     
     double calculateRange(double fuelAmount) const override {
-        return fuelAmount * fuelConsumption * 1.2;
+        return fuelAmount * getKmPerLiter();
+    }
+    
+    VehicleKind getKind() const override {
+        return VehicleKind::Motorcycle;
+    }
+    
+    double getKmPerLiter() const override {
+        return fuelConsumption * rangeFactor;
     }
     
     void doWheelie() {
@@ -135,6 +195,338 @@ unique_ptr<Vehicle> createVehicle(const string& type) {
     return nullptr;
 }
 
+// Vehicles ordered by effective km per liter, overall and per kind, so
+// range questions need a lookup instead of a virtual call per vehicle.
+// The index does not own the vehicles; remove them before they die.
+class RangeIndex {
+    typedef pair<double, const Vehicle*> Entry;
+    
+    set<Entry> all;
+    set<Entry> byKind[vehicleKindCount];
+    
+    static void checkFuel(double fuel) {
+        if (!(fuel > 0)) {
+            throw invalid_argument("Fuel amount must be positive");
+        }
+    }
+    
+    // First entry whose range on `fuel` reaches `distance`. The search key
+    // is distance / fuel; the neighbours are then checked with the same
+    // product calculateRange uses, so answers match the virtual scan exactly.
+    static set<Entry>::const_iterator firstCovering(const set<Entry>& s, double distance, double fuel) {
+        auto it = s.lower_bound(Entry(distance / fuel, nullptr));
+        while (it != s.begin() && prev(it)->first * fuel >= distance) --it;
+        while (it != s.end() && it->first * fuel < distance) ++it;
+        return it;
+    }
+    
+    static vector<const Vehicle*> covering(const set<Entry>& s, double distance, double fuel, size_t limit) {
+        checkFuel(fuel);
+        vector<const Vehicle*> out;
+        for (auto it = firstCovering(s, distance, fuel); it != s.end() && out.size() < limit; ++it) {
+            out.push_back(it->second);
+        }
+        return out;
+    }
+    
+    static vector<const Vehicle*> longest(const set<Entry>& s, size_t k) {
+        vector<const Vehicle*> out;
+        for (auto it = s.rbegin(); it != s.rend() && out.size() < k; ++it) {
+            out.push_back(it->second);
+        }
+        return out;
+    }
+    
+public:
+    RangeIndex() {}
+    
+    template<typename Fleet>
+    explicit RangeIndex(const Fleet& fleet) {
+        for (const auto& v : fleet) add(*v);
+    }
+    
+    void add(const Vehicle& v) {
+        Entry e(v.getKmPerLiter(), &v);
+        all.insert(e);
+        byKind[(int)v.getKind()].insert(e);
+    }
+    
+    bool remove(const Vehicle& v) {
+        Entry e(v.getKmPerLiter(), &v);
+        byKind[(int)v.getKind()].erase(e);
+        return all.erase(e) > 0;
+    }
+    
+    size_t size() const {
+        return all.size();
+    }
+    
+    size_t size(VehicleKind kind) const {
+        return byKind[(int)kind].size();
+    }
+    
+    bool anyCanCover(double distance, double fuel) const {
+        checkFuel(fuel);
+        return !all.empty() && all.rbegin()->first * fuel >= distance;
+    }
+    
+    // Vehicles that can cover `distance` on `fuel`, tightest fit first.
+    vector<const Vehicle*> canCover(double distance, double fuel, size_t limit = SIZE_MAX) const {
+        return covering(all, distance, fuel, limit);
+    }
+    
+    vector<const Vehicle*> canCover(double distance, double fuel, VehicleKind kind, size_t limit = SIZE_MAX) const {
+        return covering(byKind[(int)kind], distance, fuel, limit);
+    }
+    
+    // The k vehicles with the longest range, longest first.
+    vector<const Vehicle*> longestRange(size_t k) const {
+        return longest(all, k);
+    }
+    
+    vector<const Vehicle*> longestRange(size_t k, VehicleKind kind) const {
+        return longest(byKind[(int)kind], k);
+    }
+};
+
+// Binary image of a whole fleet, in native byte order:
+//   header | count fixed-width records | string table
+// Strings are stored once each as a uint32 length followed by the bytes,
+// and records refer to them by offset into the table. Opening a snapshot
+// only maps the file; Vehicle objects are built on first access, and the
+// plain fields can be queried without building anything.
+class FleetSnapshot {
+public:
+    struct Header {
+        char magic[4];
+        uint32_t version;
+        uint64_t count;
+        uint64_t stringsOffset;
+        uint64_t stringsSize;
+    };
+    
+    struct Record {
+        uint8_t kind;
+        uint8_t flag;           // truck trailer or motorcycle sidecar
+        uint16_t doors;
+        int32_t year;
+        uint32_t manufacturer;  // string table offsets
+        uint32_t model;
+        uint32_t engineType;
+        uint32_t reserved;
+        double fuelConsumption;
+        double capacity;        // car trunk or truck cargo
+    };
+    
+private:
+    static const uint32_t formatVersion = 1;
+    static const size_t pageSize = 4096;
+    
+    const char* base;
+    size_t bytes;
+    const Record* records;
+    const char* strings;
+    uint64_t stringsSize;
+    uint64_t count;
+    vector<char> buffer;
+    mutable vector<unique_ptr<unique_ptr<Vehicle>[]>> pages;
+    
+    static void corrupt() {
+        throw runtime_error("Corrupt fleet snapshot");
+    }
+    
+    string text(uint32_t offset) const {
+        uint32_t len;
+        if (offset > stringsSize || stringsSize - offset < sizeof(len)) corrupt();
+        memcpy(&len, strings + offset, sizeof(len));
+        if (stringsSize - offset - sizeof(len) < len) corrupt();
+        return string(strings + offset + sizeof(len), len);
+    }
+    
+    void open(const string& path) {
+#ifndef _WIN32
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw runtime_error("Cannot open " + path);
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(Header)) {
+            close(fd);
+            corrupt();
+        }
+        bytes = (size_t)st.st_size;
+        void* p = mmap(nullptr, bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (p == MAP_FAILED) {
+            throw runtime_error("Cannot map " + path);
+        }
+        base = static_cast<const char*>(p);
+#else
+        ifstream in(path, ios::binary);
+        if (!in) {
+            throw runtime_error("Cannot open " + path);
+        }
+        buffer.assign(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+        if (buffer.size() < sizeof(Header)) corrupt();
+        base = buffer.data();
+        bytes = buffer.size();
+#endif
+    }
+    
+    void unmap() {
+#ifndef _WIN32
+        if (base) munmap(const_cast<char*>(base), bytes);
+#endif
+        base = nullptr;
+    }
+    
+public:
+    explicit FleetSnapshot(const string& path) : base(nullptr), bytes(0) {
+        open(path);
+        const Header* h = reinterpret_cast<const Header*>(base);
+        bool ok = memcmp(h->magic, "VFLT", 4) == 0 && h->version == formatVersion
+            && h->count <= (bytes - sizeof(Header)) / sizeof(Record)
+            && h->stringsOffset >= sizeof(Header) + h->count * sizeof(Record)
+            && h->stringsOffset <= bytes && h->stringsSize <= bytes - h->stringsOffset;
+        if (!ok) {
+            unmap();
+            corrupt();
+        }
+        count = h->count;
+        records = reinterpret_cast<const Record*>(base + sizeof(Header));
+        strings = base + h->stringsOffset;
+        stringsSize = h->stringsSize;
+        pages.resize((count + pageSize - 1) / pageSize);
+    }
+    
+    FleetSnapshot(const FleetSnapshot&) = delete;
+    FleetSnapshot& operator=(const FleetSnapshot&) = delete;
+    
+    ~FleetSnapshot() {
+        unmap();
+    }
+    
+    template<typename Fleet>
+    static void write(const string& path, const Fleet& fleet) {
+        vector<Record> recs;
+        string table;
+        unordered_map<string, uint32_t> offsets;
+        auto intern = [&](const string& s) {
+            auto it = offsets.find(s);
+            if (it != offsets.end()) return it->second;
+            uint32_t offset = (uint32_t)table.size();
+            uint32_t len = (uint32_t)s.size();
+            table.append(reinterpret_cast<const char*>(&len), sizeof(len));
+            table += s;
+            offsets.emplace(s, offset);
+            return offset;
+        };
+        
+        for (const auto& v : fleet) {
+            Record r = {};
+            r.kind = (uint8_t)v->getKind();
+            r.year = v->year;
+            r.manufacturer = intern(v->manufacturer);
+            r.model = intern(v->model);
+            r.engineType = intern("");
+            r.fuelConsumption = v->fuelConsumption;
+            if (const Car* c = dynamic_cast<const Car*>(&*v)) {
+                r.doors = (uint16_t)c->doors;
+                r.capacity = c->trunkCapacity;
+            } else if (const Truck* t = dynamic_cast<const Truck*>(&*v)) {
+                r.flag = t->hasTrailer;
+                r.capacity = t->cargoCapacity;
+            } else if (const Motorcycle* m = dynamic_cast<const Motorcycle*>(&*v)) {
+                r.flag = m->hasSideCar;
+                r.engineType = intern(m->engineType);
+            }
+            recs.push_back(r);
+        }
+        
+        Header h = {};
+        memcpy(h.magic, "VFLT", 4);
+        h.version = formatVersion;
+        h.count = recs.size();
+        h.stringsOffset = sizeof(Header) + recs.size() * sizeof(Record);
+        h.stringsSize = table.size();
+        
+        ofstream out(path, ios::binary | ios::trunc);
+        out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+        out.write(reinterpret_cast<const char*>(recs.data()), recs.size() * sizeof(Record));
+        out.write(table.data(), table.size());
+        if (!out) {
+            throw runtime_error("Cannot write " + path);
+        }
+    }
+    
+    size_t size() const {
+        return count;
+    }
+    
+    // Read-only field access straight from the mapping.
+    const Record& record(size_t i) const {
+        if (i >= count) {
+            throw out_of_range("Vehicle index out of range");
+        }
+        return records[i];
+    }
+    
+    VehicleKind kind(size_t i) const {
+        return (VehicleKind)record(i).kind;
+    }
+    
+    int year(size_t i) const {
+        return record(i).year;
+    }
+    
+    double kmPerLiter(size_t i) const {
+        const Record& r = record(i);
+        switch ((VehicleKind)r.kind) {
+            case VehicleKind::Truck: return r.flag ? r.fuelConsumption * Truck::trailerFactor : r.fuelConsumption;
+            case VehicleKind::Motorcycle: return r.fuelConsumption * Motorcycle::rangeFactor;
+            default: return r.fuelConsumption;
+        }
+    }
+    
+    // Builds a fresh Vehicle from record i.
+    unique_ptr<Vehicle> materialize(size_t i) const {
+        const Record& r = record(i);
+        switch ((VehicleKind)r.kind) {
+            case VehicleKind::Car:
+                return make_unique<Car>(text(r.manufacturer), text(r.model), r.year, r.fuelConsumption, r.doors, r.capacity);
+            case VehicleKind::Truck:
+                return make_unique<Truck>(text(r.manufacturer), text(r.model), r.year, r.fuelConsumption, r.capacity, r.flag != 0);
+            case VehicleKind::Motorcycle:
+                return make_unique<Motorcycle>(text(r.manufacturer), text(r.model), r.year, r.fuelConsumption, text(r.engineType), r.flag != 0);
+        }
+        corrupt();
+        return nullptr;
+    }
+    
+    // Vehicle i, built on first access and kept until the snapshot closes.
+    // Not thread-safe.
+    const Vehicle& operator[](size_t i) const {
+        if (i >= count) {
+            throw out_of_range("Vehicle index out of range");
+        }
+        unique_ptr<unique_ptr<Vehicle>[]>& page = pages[i / pageSize];
+        if (!page) page.reset(new unique_ptr<Vehicle>[pageSize]);
+        unique_ptr<Vehicle>& slot = page[i % pageSize];
+        if (!slot) slot = materialize(i);
+        return *slot;
+    }
+};
+
+#ifndef HOMEWORK_NO_MAIN
+// Demo self-checks count their failures here; main exits nonzero if any
+// failed so ctest can catch a wrong result.
+int failedChecks = 0;
+
+bool selfCheck(bool ok) {
+    if (!ok) failedChecks++;
+    return ok;
+}
+
 int main() {
     vector<unique_ptr<Vehicle>> vehicles;
     
@@ -165,5 +557,59 @@ int main() {
         cout << "Can travel: " << v->calculateRange(50.0) << " km" << endl;
     }
     
-    return 0;
-}
\ No newline at end of file
+    cout << "\nRange index:" << endl;
+    RangeIndex index(vehicles);
+    cout << "Indexed vehicles: " << index.size() << endl;
+    cout << "Anyone for 1200 km on 50 liters? " << (index.anyCanCover(1200, 50) ? "yes" : "no") << endl;
+    cout << "Can cover 500 km on 50 liters (tightest first):" << endl;
+    for (const Vehicle* v : index.canCover(500, 50)) {
+        cout << "  " << *v << " -> " << v->calculateRange(50) << " km" << endl;
+    }
+    cout << "Two longest ranges:" << endl;
+    for (const Vehicle* v : index.longestRange(2)) {
+        cout << "  " << *v << endl;
+    }
+    cout << "Trucks for 200 km on 50 liters: " << index.canCover(200, 50, VehicleKind::Truck).size() << endl;
+    
+    index.remove(*vehicles[2]);
+    cout << "After removing the motorcycle, longest: " << *index.longestRange(1)[0] << endl;
+    cout << "Motorcycles left: " << index.size(VehicleKind::Motorcycle) << endl;
+    try {
+        index.canCover(100, 0);
+    } catch (const invalid_argument& e) {
+        cout << "Zero fuel: " << e.what() << endl;
+    }
+    
+    cout << "\nFleet snapshot:" << endl;
+    const string path = "fleet_snapshot.bin";
+    FleetSnapshot::write(path, vehicles);
+    {
+        FleetSnapshot snap(path);
+        cout << "Vehicles in snapshot: " << snap.size() << endl;
+        cout << "Record 1 without building it: year " << snap.year(1) << ", "
+             << snap.kmPerLiter(1) << " km/l" << endl;
+        for (size_t i = 0; i < snap.size(); i++) {
+            cout << "  " << snap[i] << endl;
+        }
+        bool same = true;
+        for (size_t i = 0; i < snap.size(); i++) {
+            if (snap[i].getDescription() != vehicles[i]->getDescription() ||
+                snap.kmPerLiter(i) != vehicles[i]->getKmPerLiter()) same = false;
+        }
+        cout << "Round trip matches? " << (selfCheck(same) ? "yes" : "no") << endl;
+        try {
+            snap[snap.size()];
+        } catch (const out_of_range& e) {
+            cout << "Past the end: " << e.what() << endl;
+        }
+    }
+    remove(path.c_str());
+    try {
+        FleetSnapshot missing("no_such_snapshot.bin");
+    } catch (const runtime_error& e) {
+        cout << "Missing file: " << e.what() << endl;
+    }
+    
+    return failedChecks == 0 ? 0 : 1;
+}
+#endif
\ No newline at end of file
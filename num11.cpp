@@ -3,6 +3,8 @@
 #include <vector>
 #include <string>
 #include <cstring>
+#include <cstdint>
+#include "profiler.h"
 
 using namespace std;
 
@@ -23,57 +25,223 @@ public:
     }
 };
 
-class MagicSpell {
+// Interns spell texts: every distinct text is stored once in an arena,
+// behind a small header with its hash and length. The lookup table is open
+// addressing with linear probing; slots keep the hash, so growing the table
+// never rehashes text. Interned pointers stay valid for the catalog's life.
+class SpellCatalog {
+    struct Header {
+        uint64_t hash;
+        uint32_t size;
+    };
+    
+    struct Slot {
+        uint64_t hash;
+        const char* text;
+    };
+    
+    static const size_t blockSize = 64 * 1024;
+    
+    vector<Slot> slots;
+    size_t count;
+    vector<unique_ptr<char[]>> blocks;
+    char* current;
+    size_t blockUsed;
+    size_t arenaBytes;
+    
+    static const Header* headerOf(const char* text) {
+        return reinterpret_cast<const Header*>(text - sizeof(Header));
+    }
+    
+    char* allocate(size_t bytes) {
+        bytes = (bytes + alignof(Header) - 1) & ~(alignof(Header) - 1);
+        if (bytes > blockSize) {
+            blocks.emplace_back(new char[bytes]);
+            arenaBytes += bytes;
+            return blocks.back().get();
+        }
+        if (!current || blockUsed + bytes > blockSize) {
+            blocks.emplace_back(new char[blockSize]);
+            arenaBytes += blockSize;
+            current = blocks.back().get();
+            blockUsed = 0;
+        }
+        char* p = current + blockUsed;
+        blockUsed += bytes;
+        return p;
+    }
+    
+    void grow() {
+        vector<Slot> old(slots.empty() ? 1024 : slots.size() * 2, Slot{ 0, nullptr });
+        old.swap(slots);
+        size_t mask = slots.size() - 1;
+        for (const Slot& s : old) {
+            if (!s.text) continue;
+            size_t i = s.hash & mask;
+            while (slots[i].text) i = (i + 1) & mask;
+            slots[i] = s;
+        }
+    }
+    
+public:
+    SpellCatalog() : count(0), current(nullptr), blockUsed(0), arenaBytes(0) {}
+    
+    SpellCatalog(const SpellCatalog&) = delete;
+    SpellCatalog& operator=(const SpellCatalog&) = delete;
+    
+    // FNV-1a
+    static uint64_t hashOf(const char* t, size_t n) {
+        uint64_t h = 14695981039346656037ULL;
+        for (size_t i = 0; i < n; i++) {
+            h ^= (unsigned char)t[i];
+            h *= 1099511628211ULL;
+        }
+        return h;
+    }
+    
+    static uint64_t hashOfInterned(const char* text) {
+        return headerOf(text)->hash;
+    }
+    
+    static int sizeOfInterned(const char* text) {
+        return (int)headerOf(text)->size;
+    }
+    
+    // Returns the catalog's copy of t, adding it on first sight.
+    const char* intern(const char* t) {
+        size_t n = strlen(t);
+        uint64_t h = hashOf(t, n);
+        if ((count + 1) * 10 > slots.size() * 7) grow();
+        size_t mask = slots.size() - 1;
+        size_t i = h & mask;
+        while (slots[i].text) {
+            if (slots[i].hash == h && headerOf(slots[i].text)->size == n && memcmp(slots[i].text, t, n) == 0) {
+                return slots[i].text;
+            }
+            i = (i + 1) & mask;
+        }
+        
+        char* p = allocate(sizeof(Header) + n + 1);
+        Header* header = reinterpret_cast<Header*>(p);
+        header->hash = h;
+        header->size = (uint32_t)n;
+        char* text = p + sizeof(Header);
+        memcpy(text, t, n + 1);
+        slots[i] = Slot{ h, text };
+        count++;
+        return text;
+    }
+    
+    size_t size() const {
+        return count;
+    }
+    
+    // Arena blocks plus the slot array.
+    size_t bytes() const {
+        return arenaBytes + slots.size() * sizeof(Slot);
+    }
+};
+
+// A spell either owns a heap copy of its text or, when built from a
+// SpellCatalog, points at the catalog's copy. Catalog-backed spells copy
+// without allocating and compare by pointer; the catalog must outlive them.
+class MagicSpell : prof::Tracked<MagicSpell> {
     char* text;
     int size;
+    bool interned;
+    
+    void release() {
+        if (text && !interned) {
+            prof::recordFree<MagicSpell>(size + 1);
+            delete[] text;
+        }
+    }
+    
+    void copyFrom(const MagicSpell& other) {
+        size = other.size;
+        interned = other.interned;
+        if (interned || !other.text) {
+            text = other.text;
+            return;
+        }
+        text = new char[size + 1];
+        prof::recordAlloc<MagicSpell>(size + 1);
+        strcpy(text, other.text);
+    }
     
 public:
-    MagicSpell(const char* t) : size(strlen(t)) {
+    MagicSpell(const char* t) : size(strlen(t)), interned(false) {
         text = new char[size + 1];
+        prof::recordAlloc<MagicSpell>(size + 1);
         strcpy(text, t);
         cout << "MagicSpell constructor: " << text << endl;
     }
     
+    MagicSpell(SpellCatalog& catalog, const char* t) : interned(true) {
+        text = const_cast<char*>(catalog.intern(t));
+        size = SpellCatalog::sizeOfInterned(text);
+        cout << "MagicSpell catalog constructor: " << text << endl;
+    }
+    
     ~MagicSpell() {
         cout << "MagicSpell destructor: " << (text ? text : "empty") << endl;
-        delete[] text;
+        release();
     }
     
-    MagicSpell(const MagicSpell& other) : size(other.size) {
-        text = new char[size + 1];
-        strcpy(text, other.text);
-        cout << "MagicSpell copy constructor: " << text << endl;
+    MagicSpell(const MagicSpell& other) : prof::Tracked<MagicSpell>(other) {
+        copyFrom(other);
+        cout << "MagicSpell copy constructor: " << (text ? text : "empty") << endl;
     }
     
-    MagicSpell(MagicSpell&& other) noexcept : text(other.text), size(other.size) {
+    MagicSpell(MagicSpell&& other) noexcept 
+        : prof::Tracked<MagicSpell>(move(other)), text(other.text), size(other.size), interned(other.interned) {
         other.text = nullptr;
         other.size = 0;
+        other.interned = false;
         cout << "MagicSpell move constructor" << endl;
     }
     
     MagicSpell& operator=(const MagicSpell& other) {
         if (this != &other) {
-            delete[] text;
-            size = other.size;
-            text = new char[size + 1];
-            strcpy(text, other.text);
-            cout << "Copy assignment: " << text << endl;
+            release();
+            copyFrom(other);
+            cout << "Copy assignment: " << (text ? text : "empty") << endl;
         }
         return *this;
     }
     
     MagicSpell& operator=(MagicSpell&& other) noexcept {
         if (this != &other) {
-            delete[] text;
+            release();
             text = other.text;
             size = other.size;
+            interned = other.interned;
             other.text = nullptr;
             other.size = 0;
+            other.interned = false;
             cout << "Move assignment" << endl;
         }
         return *this;
     }
     
+    // O(1) for two catalog-backed spells: one catalog stores each text once,
+    // so different pointers with the same hash only happen across catalogs.
+    bool operator==(const MagicSpell& other) const {
+        if (text == other.text) return true;
+        if (!text || !other.text || size != other.size) return false;
+        if (interned && other.interned &&
+            SpellCatalog::hashOfInterned(text) != SpellCatalog::hashOfInterned(other.text)) return false;
+        return memcmp(text, other.text, size) == 0;
+    }
+    
+    bool operator!=(const MagicSpell& other) const {
+        return !(*this == other);
+    }
+    
+    bool isInterned() const {
+        return interned;
+    }
+    
     void print() const {
         if (text) cout << "Current spell: " << text << endl;
         else cout << "Spell is empty" << endl;
@@ -214,11 +382,32 @@ void testSharedWeakPtr() {
     spectator.observe();
 }
 
+void testCatalog() {
+    cout << "\n=== Test 4: spell catalog ===" << endl;
+    SpellCatalog catalog;
+    MagicSpell a(catalog, "Wingardium Leviosa");
+    MagicSpell b(catalog, "Wingardium Leviosa");
+    MagicSpell c(catalog, "Alohomora");
+    MagicSpell d = a;
+    MagicSpell owned("Wingardium Leviosa");
+    cout << "Distinct texts in catalog: " << catalog.size() << endl;
+    cout << "a == b? " << (a == b ? "yes" : "no") << endl;
+    cout << "a == c? " << (a == c ? "yes" : "no") << endl;
+    cout << "Copy of a is interned? " << (d.isInterned() ? "yes" : "no") << endl;
+    cout << "a == owned copy? " << (a == owned ? "yes" : "no") << endl;
+    owned = c;
+    cout << "Owned spell after assignment is interned? " << (owned.isInterned() ? "yes" : "no") << endl;
+    owned.print();
+}
+
+#ifndef HOMEWORK_NO_MAIN
 int main() {
     testRuleOfFive();
     testUniquePtr();
     testSharedWeakPtr();
+    testCatalog();
     
     cout << "\nAll tests done" << endl;
     return 0;
-}
\ No newline at end of file
+}
+#endif
\ No newline at end of file
@@ -1,52 +1,433 @@
 #include <iostream>
 #include <stdexcept>
+#include <string>
+#include <cstring>
+#include <cstdio>
+#include <climits>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <algorithm>
+#include <numeric>
+#include <cstdint>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#include "profiler.h"
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 using namespace std;
 
-class SafeArray {
+enum class Storage { Heap, Anonymous, File };
+
+class ThreadPool {
+    struct Queue {
+        mutex m;
+        deque<function<void()>> tasks;
+    };
+    
+    vector<unique_ptr<Queue>> queues;
+    vector<thread> workers;
+    atomic<int> queued;
+    atomic<unsigned> nextQueue;
+    bool stopping;
+    mutex sleepMutex;
+    condition_variable wake;
+    // worker index of the calling thread, valid only while owner == this
+    static thread_local ThreadPool* owner;
+    static thread_local int self;
+    
+    int homeQueue() {
+        return owner == this ? self : -1;
+    }
+    
+    bool take(int home, function<void()>& task) {
+        int n = queues.size();
+        for (int i = 0; i < n; i++) {
+            Queue& q = *queues[(home + i) % n];
+            lock_guard<mutex> lock(q.m);
+            if (q.tasks.empty()) continue;
+            if (i == 0) {
+                task = move(q.tasks.back());
+                q.tasks.pop_back();
+            } else {
+                task = move(q.tasks.front());
+                q.tasks.pop_front();
+            }
+            queued--;
+            return true;
+        }
+        return false;
+    }
+    
+    void loop(int id) {
+        owner = this;
+        self = id;
+        function<void()> task;
+        while (true) {
+            if (take(id, task)) {
+                task();
+                continue;
+            }
+            unique_lock<mutex> lock(sleepMutex);
+            wake.wait(lock, [this] { return stopping || queued > 0; });
+            if (stopping && queued == 0) return;
+        }
+    }
+    
+public:
+    explicit ThreadPool(int n) : queued(0), nextQueue(0), stopping(false) {
+        for (int i = 0; i < n; i++) {
+            queues.push_back(make_unique<Queue>());
+        }
+        for (int i = 0; i < n; i++) {
+            workers.emplace_back(&ThreadPool::loop, this, i);
+        }
+    }
+    
+    ~ThreadPool() {
+        {
+            lock_guard<mutex> lock(sleepMutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (thread& t : workers) {
+            t.join();
+        }
+    }
+    
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+    
+    static ThreadPool& shared() {
+        static ThreadPool pool(max(1, (int)thread::hardware_concurrency() - 1));
+        return pool;
+    }
+    
+    int size() const {
+        return workers.size();
+    }
+    
+    void submit(function<void()> task) {
+        int home = homeQueue();
+        if (home < 0) home = nextQueue++ % queues.size();
+        {
+            lock_guard<mutex> lock(queues[home]->m);
+            queues[home]->tasks.push_back(move(task));
+        }
+        queued++;
+        {
+            lock_guard<mutex> lock(sleepMutex);
+        }
+        wake.notify_one();
+    }
+    
+    bool runOne() {
+        function<void()> task;
+        int home = homeQueue();
+        if (!take(home >= 0 ? home : 0, task)) return false;
+        task();
+        return true;
+    }
+};
+
+thread_local ThreadPool* ThreadPool::owner = nullptr;
+thread_local int ThreadPool::self = -1;
+
+class TaskGroup {
+    ThreadPool& pool;
+    atomic<int> left;
+    mutex errorMutex;
+    exception_ptr error;
+    
+public:
+    explicit TaskGroup(ThreadPool& p) : pool(p), left(0) {}
+    
+    template<typename F>
+    void run(F f) {
+        left++;
+        pool.submit([this, f] {
+            try {
+                f();
+            } catch (...) {
+                lock_guard<mutex> lock(errorMutex);
+                if (!error) error = current_exception();
+            }
+            left--;
+        });
+    }
+    
+    void wait() {
+        while (left > 0) {
+            if (!pool.runOne()) this_thread::yield();
+        }
+        if (error) rethrow_exception(error);
+    }
+};
+
+class SafeArray : prof::Tracked<SafeArray> {
 private:
     int* arr;
     int sz;
+    Storage storage;
+    int fd;
+    size_t mapped;
+    atomic<int>* refs;
+    bool leaked;
+    static int maxSize;
+    static int threads;
+    
+    static size_t mapBytes(int n) {
+#ifndef _WIN32
+        size_t page = sysconf(_SC_PAGESIZE);
+        size_t bytes = (size_t)n * sizeof(int);
+        // an empty array still keeps one page so mmap/mremap never see length 0
+        return bytes == 0 ? page : (bytes + page - 1) / page * page;
+#else
+        return (size_t)n * sizeof(int);
+#endif
+    }
+    
+    void allocate(int n, const string& path) {
+        fd = -1;
+        mapped = 0;
+        if (storage == Storage::Heap) {
+            arr = new int[n]();
+            prof::recordAlloc<SafeArray>((size_t)n * sizeof(int));
+            return;
+        }
+#ifndef _WIN32
+        mapped = mapBytes(n);
+        void* p;
+        if (storage == Storage::File) {
+            fd = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+            if (fd < 0) {
+                throw runtime_error("Cannot open " + path);
+            }
+            if (ftruncate(fd, (off_t)n * sizeof(int)) != 0) {
+                close(fd);
+                throw runtime_error("Cannot grow " + path);
+            }
+            p = mmap(nullptr, mapped, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        } else {
+            p = mmap(nullptr, mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+#ifdef MADV_HUGEPAGE
+            if (p != MAP_FAILED) madvise(p, mapped, MADV_HUGEPAGE);
+#endif
+        }
+        if (p == MAP_FAILED) {
+            if (fd >= 0) close(fd);
+            throw bad_alloc();
+        }
+        arr = static_cast<int*>(p);
+        prof::recordAlloc<SafeArray>(mapped);
+#else
+        throw invalid_argument("Storage not supported");
+#endif
+    }
+    
+    void release() noexcept {
+        if (refs->fetch_sub(1, memory_order_acq_rel) != 1) return;
+        delete refs;
+        prof::recordFree<SafeArray>(storage == Storage::Heap ? (size_t)sz * sizeof(int) : mapped);
+        if (storage == Storage::Heap) {
+            delete[] arr;
+            return;
+        }
+#ifndef _WIN32
+        munmap(arr, mapped);
+        if (fd >= 0) close(fd);
+#endif
+    }
+    
+    // Copies share one buffer until someone writes. Once the non-const
+    // operator[] has handed out a reference the buffer is marked leaked,
+    // and copies of it are deep so the reference cannot reach them. Calls
+    // that rewrite the whole buffer (fill, sort, transform, inclusiveScan,
+    // resize) invalidate such references and clear the mark.
+    void detach() {
+        if (refs->load(memory_order_acquire) == 1) return;
+        
+        PROF_SCOPE(SafeArray, "detach");
+        int* oldArr = arr;
+        size_t oldMapped = mapped;
+        atomic<int>* oldRefs = refs;
+        try {
+            allocate(sz, "");
+        } catch (...) {
+            arr = oldArr;
+            mapped = oldMapped;
+            throw;
+        }
+        memcpy(arr, oldArr, sz * sizeof(int));
+        
+        int* newArr = arr;
+        size_t newMapped = mapped;
+        arr = oldArr;
+        mapped = oldMapped;
+        refs = oldRefs;
+        release();
+        arr = newArr;
+        mapped = newMapped;
+        refs = new atomic<int>(1);
+        leaked = false;
+    }
+    
+    void remap(int newSize) {
+#ifndef _WIN32
+        size_t bytes = mapBytes(newSize);
+        // The file is resized before the mapping so that a failure at either
+        // step leaves the array as it was.
+        if (storage == Storage::File &&
+            ftruncate(fd, (off_t)newSize * sizeof(int)) != 0) {
+            throw runtime_error(newSize > sz ? "Cannot grow file" : "Cannot shrink file");
+        }
+        if (bytes != mapped) {
+#ifdef MREMAP_MAYMOVE
+            void* p = mremap(arr, mapped, bytes, MREMAP_MAYMOVE);
+#else
+            int flags = storage == Storage::File ? MAP_SHARED : MAP_PRIVATE | MAP_ANONYMOUS;
+            void* p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, flags, fd, 0);
+#endif
+            if (p == MAP_FAILED) {
+                if (storage == Storage::File &&
+                    ftruncate(fd, (off_t)sz * sizeof(int)) != 0) {
+                    throw runtime_error("Cannot restore file size");
+                }
+                throw bad_alloc();
+            }
+#ifndef MREMAP_MAYMOVE
+            if (storage != Storage::File) {
+                memcpy(p, arr, (newSize < sz ? newSize : sz) * sizeof(int));
+            }
+            munmap(arr, mapped);
+#endif
+#ifdef MADV_HUGEPAGE
+            if (storage == Storage::Anonymous) madvise(p, bytes, MADV_HUGEPAGE);
+#endif
+            arr = static_cast<int*>(p);
+            prof::recordFree<SafeArray>(mapped);
+            prof::recordAlloc<SafeArray>(bytes);
+        }
+        if (newSize > sz) {
+            // pages kept from the old mapping may still hold values from before a shrink
+            size_t kept = mapped / sizeof(int) < (size_t)newSize ? mapped / sizeof(int) : newSize;
+            if (kept > (size_t)sz) memset(arr + sz, 0, (kept - sz) * sizeof(int));
+        }
+        mapped = bytes;
+        leaked = false;
+#endif
+    }
+    
+    int chunkCount() const {
+        int t = threads > 0 ? threads : ThreadPool::shared().size() + 1;
+        int byGrain = sz / 4096;
+        return max(1, min(t, byGrain));
+    }
+    
+    int chunkStart(int chunk, int chunks) const {
+        return (long long)sz * chunk / chunks;
+    }
+    
+    template<typename F>
+    void parallelChunks(int chunks, F body) const {
+        if (chunks == 1) {
+            body(0);
+            return;
+        }
+        TaskGroup group(ThreadPool::shared());
+        for (int c = 1; c < chunks; c++) {
+            group.run([&body, c] { body(c); });
+        }
+        try {
+            body(0);
+        } catch (...) {
+            group.wait();
+            throw;
+        }
+        group.wait();
+    }
     
 public:
-    SafeArray(int n) : sz(n) {
+    SafeArray(int n, Storage s = Storage::Heap, const string& path = "") : sz(n), storage(s), leaked(false) {
         if (n <= 0) {
             throw invalid_argument("Bad size");
         }
-        arr = new int[n]();
+        if (n > maxSize) {
+            throw length_error("Too big");
+        }
+        allocate(n, path);
+        refs = new atomic<int>(1);
     }
     
     ~SafeArray() noexcept {
-        delete[] arr;
+        release();
     }
     
-    SafeArray(const SafeArray& other) : sz(other.sz) {
-        arr = new int[sz];
-        for (int i = 0; i < sz; i++) {
-            arr[i] = other.arr[i];
+    SafeArray(const SafeArray& other) : prof::Tracked<SafeArray>(other), sz(other.sz), leaked(false) {
+        if (other.storage == Storage::File || other.leaked) {
+            storage = other.storage == Storage::File ? Storage::Anonymous : other.storage;
+            allocate(sz, "");
+            memcpy(arr, other.arr, sz * sizeof(int));
+            refs = new atomic<int>(1);
+            return;
         }
+        arr = other.arr;
+        storage = other.storage;
+        fd = -1;
+        mapped = other.mapped;
+        refs = other.refs;
+        refs->fetch_add(1, memory_order_relaxed);
     }
     
     SafeArray& operator=(const SafeArray& other) {
         if (this == &other) return *this;
         
-        int* newArr = new int[other.sz];
-        for (int i = 0; i < other.sz; i++) {
-            newArr[i] = other.arr[i];
+        if (storage == Storage::File) {
+            resize(other.sz);
+            memcpy(arr, other.arr, sz * sizeof(int));
+            return *this;
         }
-        
-        delete[] arr;
-        arr = newArr;
-        sz = other.sz;
+        SafeArray copy(other);
+        swap(arr, copy.arr);
+        swap(sz, copy.sz);
+        swap(storage, copy.storage);
+        swap(fd, copy.fd);
+        swap(mapped, copy.mapped);
+        swap(refs, copy.refs);
+        swap(leaked, copy.leaked);
         return *this;
     }
     
+    // The returned reference stays valid until the next fill, sort,
+    // transform, inclusiveScan or resize. Until then copies of this array
+    // are deep rather than shared; use set() to write without that cost.
     int& operator[](int idx) {
         if (idx < 0 || idx >= sz) {
             throw out_of_range("Bad index");
         }
+        detach();
+        leaked = true;
         return arr[idx];
     }
     
+    // Checked write that keeps the buffer shareable, unlike operator[].
+    void set(int idx, int val) {
+        if (idx < 0 || idx >= sz) {
+            throw out_of_range("Bad index");
+        }
+        detach();
+        arr[idx] = val;
+    }
+    
     const int& operator[](int idx) const {
         if (idx < 0 || idx >= sz) {
             throw out_of_range("Bad index");
@@ -55,22 +436,33 @@ public:
     }
     
     void resize(int newSize) {
-        if (newSize > 1000) {
+        PROF_SCOPE(SafeArray, "resize");
+        if (newSize > maxSize) {
             throw length_error("Too big");
         }
         
         if (newSize == sz) return;
         
+        if (storage != Storage::Heap) {
+            detach();
+            remap(newSize);
+            sz = newSize;
+            return;
+        }
+        
         int* newArr = new int[newSize]();
+        prof::recordAlloc<SafeArray>((size_t)newSize * sizeof(int));
         
         int smaller = newSize < sz ? newSize : sz;
         for (int i = 0; i < smaller; i++) {
             newArr[i] = arr[i];
         }
         
-        delete[] arr;
+        release();
         arr = newArr;
         sz = newSize;
+        refs = new atomic<int>(1);
+        leaked = false;
     }
     
     int size() const {
@@ -78,12 +470,489 @@ public:
     }
     
     void fill(int val) {
+        detach();
+        leaked = false;
         for (int i = 0; i < sz; i++) {
             arr[i] = val;
         }
     }
+    
+    Storage getStorage() const {
+        return storage;
+    }
+    
+    bool isShared() const {
+        return refs->load(memory_order_acquire) > 1;
+    }
+    
+    void flush() {
+#ifndef _WIN32
+        if (storage == Storage::File) {
+            msync(arr, mapped, MS_SYNC);
+        }
+#endif
+    }
+    
+    static void setMaxSize(int n) {
+        if (n <= 0) {
+            throw invalid_argument("Bad size");
+        }
+        maxSize = n;
+    }
+    
+    static int getMaxSize() {
+        return maxSize;
+    }
+    
+    static void setThreads(int n) {
+        threads = n < 0 ? 0 : n;
+    }
+    
+    void sort() {
+        PROF_SCOPE(SafeArray, "sort");
+        detach();
+        leaked = false;
+        int chunks = chunkCount();
+        vector<int> bounds(chunks + 1);
+        for (int c = 0; c <= chunks; c++) {
+            bounds[c] = chunkStart(c, chunks);
+        }
+        parallelChunks(chunks, [&](int c) {
+            std::sort(arr + bounds[c], arr + bounds[c + 1]);
+        });
+        for (int step = 1; step < chunks; step *= 2) {
+            int pairs = (chunks + 2 * step - 1) / (2 * step);
+            parallelChunks(pairs, [&](int p) {
+                int lo = p * 2 * step;
+                int mid = lo + step;
+                if (mid >= chunks) return;
+                int hi = min(mid + step, chunks);
+                inplace_merge(arr + bounds[lo], arr + bounds[mid], arr + bounds[hi]);
+            });
+        }
+    }
+    
+    template<typename T, typename Op>
+    T reduce(T init, Op op) const {
+        if (sz == 0) return init;
+        int chunks = chunkCount();
+        vector<T> partial(chunks);
+        vector<char> seeded(chunks);
+        parallelChunks(chunks, [&](int c) {
+            int lo = chunkStart(c, chunks), hi = chunkStart(c + 1, chunks);
+            if (lo == hi) return;
+            T acc = arr[lo];
+            for (int i = lo + 1; i < hi; i++) {
+                acc = op(acc, arr[i]);
+            }
+            partial[c] = acc;
+            seeded[c] = 1;
+        });
+        for (int c = 0; c < chunks; c++) {
+            if (seeded[c]) init = op(init, partial[c]);
+        }
+        return init;
+    }
+    
+    template<typename Op>
+    void inclusiveScan(Op op) {
+        detach();
+        leaked = false;
+        int chunks = chunkCount();
+        parallelChunks(chunks, [&](int c) {
+            int lo = chunkStart(c, chunks), hi = chunkStart(c + 1, chunks);
+            for (int i = lo + 1; i < hi; i++) {
+                arr[i] = op(arr[i - 1], arr[i]);
+            }
+        });
+        vector<int> carry(chunks);
+        for (int c = 1; c < chunks; c++) {
+            int prevEnd = chunkStart(c, chunks) - 1;
+            carry[c] = c == 1 ? arr[prevEnd] : op(carry[c - 1], arr[prevEnd]);
+        }
+        parallelChunks(chunks, [&](int c) {
+            if (c == 0) return;
+            int lo = chunkStart(c, chunks), hi = chunkStart(c + 1, chunks);
+            for (int i = lo; i < hi; i++) {
+                arr[i] = op(carry[c], arr[i]);
+            }
+        });
+    }
+    
+    template<typename F>
+    void transform(F f) {
+        detach();
+        leaked = false;
+        int chunks = chunkCount();
+        parallelChunks(chunks, [&](int c) {
+            int lo = chunkStart(c, chunks), hi = chunkStart(c + 1, chunks);
+            for (int i = lo; i < hi; i++) {
+                arr[i] = f(arr[i]);
+            }
+        });
+    }
+    
+    int find(int val) const {
+        int chunks = chunkCount();
+        atomic<int> found(INT_MAX);
+        parallelChunks(chunks, [&](int c) {
+            int lo = chunkStart(c, chunks), hi = chunkStart(c + 1, chunks);
+            for (int i = lo; i < hi; i++) {
+                if ((i & 4095) == 0 && found.load(memory_order_relaxed) < i) return;
+                if (arr[i] == val) {
+                    int cur = found.load();
+                    while (i < cur && !found.compare_exchange_weak(cur, i)) {}
+                    return;
+                }
+            }
+        });
+        return found == INT_MAX ? -1 : found.load();
+    }
 };
 
+int SafeArray::maxSize = INT_MAX;
+int SafeArray::threads = 0;
+
+// Compressed SafeArray: values are stored in blocks of 128, each block as
+// offsets from its minimum packed at the smallest width that fits (0-32
+// bits). Frame of reference never needs more bits than plain minimum width,
+// and also handles negative or large-but-narrow ranges. Inside a block,
+// value j sits in 32-bit lane j % 4, so whole blocks encode and decode with
+// SSE2 shifts. A write that does not fit re-encodes its block wider; the
+// old words are reclaimed when more than half the pool is stale.
+class PackedSafeArray : prof::Tracked<PackedSafeArray> {
+public:
+    static constexpr int blockSize = 128;
+    
+    class Reference {
+        PackedSafeArray& owner;
+        int idx;
+        
+        friend class PackedSafeArray;
+        Reference(PackedSafeArray& o, int i) : owner(o), idx(i) {}
+        
+    public:
+        operator int() const {
+            return owner.get(idx);
+        }
+        
+        Reference& operator=(int val) {
+            owner.set(idx, val);
+            return *this;
+        }
+        
+        Reference& operator=(const Reference& other) {
+            return *this = (int)other;
+        }
+        
+        Reference& operator+=(int val) {
+            owner.set(idx, owner.get(idx) + val);
+            return *this;
+        }
+    };
+    
+private:
+    struct Block {
+        int base;
+        uint32_t offset;
+        uint8_t bits;
+        uint8_t capacity;
+    };
+    
+    // packed blocks followed by one group of padding, so a value in the
+    // last word of a block can always be read as a 64-bit pair
+    vector<uint32_t> words;
+    vector<Block> blocks;
+    int sz;
+    size_t wasted;
+    
+    static uint32_t maskOf(int bits) {
+        return bits == 32 ? 0xFFFFFFFFu : (1u << bits) - 1;
+    }
+    
+    static int widthOf(uint32_t range) {
+        int bits = 0;
+        while (bits < 32 && (range >> bits) != 0) bits++;
+        return bits;
+    }
+    
+    static void decodeLanes(const uint32_t* in, int bits, int base, int* out) {
+#ifdef __SSE2__
+        __m128i mask = _mm_set1_epi32((int)maskOf(bits));
+        __m128i offset = _mm_set1_epi32(base);
+        const __m128i* src = reinterpret_cast<const __m128i*>(in);
+        __m128i cur = _mm_loadu_si128(src);
+        int shift = 0, w = 0;
+        for (int k = 0; k < blockSize / 4; k++) {
+            __m128i v = _mm_srl_epi32(cur, _mm_cvtsi32_si128(shift));
+            if (shift + bits >= 32) {
+                if (++w < bits) {
+                    cur = _mm_loadu_si128(src + w);
+                    if (shift + bits > 32) v = _mm_or_si128(v, _mm_sll_epi32(cur, _mm_cvtsi32_si128(32 - shift)));
+                }
+                shift += bits - 32;
+            } else {
+                shift += bits;
+            }
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 4 * k), _mm_add_epi32(_mm_and_si128(v, mask), offset));
+        }
+#else
+        uint32_t mask = maskOf(bits);
+        for (int j = 0; j < blockSize; j++) {
+            unsigned pos = (j >> 2) * bits;
+            const uint32_t* w = in + (pos >> 5) * 4 + (j & 3);
+            uint64_t pair = w[0];
+            if ((pos & 31) + bits > 32) pair |= (uint64_t)w[4] << 32;
+            out[j] = (int)((uint32_t)base + (uint32_t)((pair >> (pos & 31)) & mask));
+        }
+#endif
+    }
+    
+    // every in[j] - base must fit in `bits`
+    static void encodeLanes(const int* in, int bits, int base, uint32_t* out) {
+#ifdef __SSE2__
+        __m128i offset = _mm_set1_epi32(base);
+        __m128i acc = _mm_setzero_si128();
+        __m128i* dst = reinterpret_cast<__m128i*>(out);
+        int shift = 0, w = 0;
+        for (int k = 0; k < blockSize / 4; k++) {
+            __m128i v = _mm_sub_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 4 * k)), offset);
+            acc = _mm_or_si128(acc, _mm_sll_epi32(v, _mm_cvtsi32_si128(shift)));
+            if (shift + bits >= 32) {
+                _mm_storeu_si128(dst + w++, acc);
+                acc = shift + bits > 32 ? _mm_srl_epi32(v, _mm_cvtsi32_si128(32 - shift)) : _mm_setzero_si128();
+                shift += bits - 32;
+            } else {
+                shift += bits;
+            }
+        }
+#else
+        memset(out, 0, bits * 4 * sizeof(uint32_t));
+        for (int j = 0; j < blockSize; j++) {
+            uint32_t delta = (uint32_t)in[j] - (uint32_t)base;
+            unsigned pos = (j >> 2) * bits;
+            uint32_t* w = out + (pos >> 5) * 4 + (j & 3);
+            w[0] |= delta << (pos & 31);
+            if ((pos & 31) + bits > 32) w[4] |= delta >> (32 - (pos & 31));
+        }
+#endif
+    }
+    
+    int validIn(int b) const {
+        return min(blockSize, sz - b * blockSize);
+    }
+    
+    void decodeBlock(int b, int* out) const {
+        const Block& blk = blocks[b];
+        if (blk.bits == 0) {
+            std::fill(out, out + blockSize, blk.base);
+            return;
+        }
+        decodeLanes(words.data() + blk.offset, blk.bits, blk.base, out);
+    }
+    
+    // Encodes 128 values (only the first validIn(b) matter) at the
+    // narrowest width, moving the block to the end of the pool if it grew.
+    void encodeBlock(int b, int* vals) {
+        int n = validIn(b);
+        int lo = vals[0], hi = vals[0];
+        for (int i = 1; i < n; i++) {
+            lo = min(lo, vals[i]);
+            hi = max(hi, vals[i]);
+        }
+        std::fill(vals + n, vals + blockSize, lo);
+        int bits = widthOf((uint32_t)hi - (uint32_t)lo);
+        
+        Block& blk = blocks[b];
+        if (bits > blk.capacity) {
+            wasted += blk.capacity * 4;
+            blk.offset = (uint32_t)(words.size() - 4);
+            words.resize(words.size() + bits * 4);
+            blk.capacity = bits;
+        }
+        blk.base = lo;
+        blk.bits = bits;
+        if (bits) encodeLanes(vals, bits, lo, words.data() + blk.offset);
+    }
+    
+    void widen(int idx, int val) {
+        PROF_SCOPE(PackedSafeArray, "widen");
+        int b = idx / blockSize;
+        int buf[blockSize];
+        decodeBlock(b, buf);
+        buf[idx % blockSize] = val;
+        encodeBlock(b, buf);
+        if (wasted * 2 > words.size()) repack();
+    }
+    
+    int get(int idx) const {
+        const Block& blk = blocks[idx / blockSize];
+        if (blk.bits == 0) return blk.base;
+        int j = idx % blockSize;
+        unsigned pos = (j >> 2) * blk.bits;
+        const uint32_t* w = words.data() + blk.offset + (pos >> 5) * 4 + (j & 3);
+        uint64_t pair = w[0] | (uint64_t)w[4] << 32;
+        return (int)((uint32_t)blk.base + (uint32_t)((pair >> (pos & 31)) & maskOf(blk.bits)));
+    }
+    
+    void set(int idx, int val) {
+        const Block& blk = blocks[idx / blockSize];
+        uint32_t delta = (uint32_t)val - (uint32_t)blk.base;
+        if (val < blk.base || delta > maskOf(blk.bits)) {
+            widen(idx, val);
+            return;
+        }
+        if (blk.bits == 0) return;
+        int j = idx % blockSize;
+        unsigned pos = (j >> 2) * blk.bits;
+        uint32_t* w = words.data() + blk.offset + (pos >> 5) * 4 + (j & 3);
+        uint64_t pair = w[0] | (uint64_t)w[4] << 32;
+        uint64_t mask = (uint64_t)maskOf(blk.bits) << (pos & 31);
+        pair = (pair & ~mask) | (uint64_t)delta << (pos & 31);
+        w[0] = (uint32_t)pair;
+        w[4] = (uint32_t)(pair >> 32);
+    }
+    
+    void checkIndex(int idx) const {
+        if (idx < 0 || idx >= sz) {
+            throw out_of_range("Bad index");
+        }
+    }
+    
+public:
+    PackedSafeArray(int n) : sz(n), wasted(0) {
+        if (n <= 0) {
+            throw invalid_argument("Bad size");
+        }
+        if (n > SafeArray::getMaxSize()) {
+            throw length_error("Too big");
+        }
+        blocks.assign((n + blockSize - 1) / blockSize, Block{ 0, 0, 0, 0 });
+        words.assign(4, 0);
+    }
+    
+    PackedSafeArray(const int* src, int n) : PackedSafeArray(n) {
+        assign(src);
+    }
+    
+    explicit PackedSafeArray(const SafeArray& src) : PackedSafeArray(src.size()) {
+        int buf[blockSize];
+        for (int b = 0; b < (int)blocks.size(); b++) {
+            for (int i = 0; i < validIn(b); i++) {
+                buf[i] = src[b * blockSize + i];
+            }
+            encodeBlock(b, buf);
+        }
+        words.shrink_to_fit();
+    }
+    
+    Reference operator[](int idx) {
+        checkIndex(idx);
+        return Reference(*this, idx);
+    }
+    
+    int operator[](int idx) const {
+        checkIndex(idx);
+        return get(idx);
+    }
+    
+    int size() const {
+        return sz;
+    }
+    
+    // Bytes used by the packed words and block headers.
+    size_t bytes() const {
+        return words.capacity() * sizeof(uint32_t) + blocks.capacity() * sizeof(Block);
+    }
+    
+    void fill(int val) {
+        for (Block& blk : blocks) {
+            blk = Block{ val, 0, 0, 0 };
+        }
+        words.assign(4, 0);
+        words.shrink_to_fit();
+        wasted = 0;
+    }
+    
+    // Bulk encode of size() values, replacing the contents.
+    void assign(const int* src) {
+        words.assign(4, 0);
+        wasted = 0;
+        int buf[blockSize];
+        for (int b = 0; b < (int)blocks.size(); b++) {
+            blocks[b] = Block{ 0, 0, 0, 0 };
+            memcpy(buf, src + (size_t)b * blockSize, validIn(b) * sizeof(int));
+            encodeBlock(b, buf);
+        }
+        words.shrink_to_fit();
+    }
+    
+    // Bulk decode of all size() values into out.
+    void copyTo(int* out) const {
+        int last = (int)blocks.size() - 1;
+        for (int b = 0; b < last; b++) {
+            decodeBlock(b, out + (size_t)b * blockSize);
+        }
+        int buf[blockSize];
+        decodeBlock(last, buf);
+        memcpy(out + (size_t)last * blockSize, buf, validIn(last) * sizeof(int));
+    }
+    
+    SafeArray unpack() const {
+        SafeArray out(sz);
+        int buf[blockSize];
+        for (int b = 0; b < (int)blocks.size(); b++) {
+            decodeBlock(b, buf);
+            for (int i = 0; i < validIn(b); i++) {
+                out.set(b * blockSize + i, buf[i]);
+            }
+        }
+        return out;
+    }
+    
+    // Sequential fold over the values, decoding one block at a time.
+    template<typename T, typename Op>
+    T reduce(T init, Op op) const {
+        int buf[blockSize];
+        for (int b = 0; b < (int)blocks.size(); b++) {
+            decodeBlock(b, buf);
+            int n = validIn(b);
+            for (int i = 0; i < n; i++) {
+                init = op(init, buf[i]);
+            }
+        }
+        return init;
+    }
+    
+    // Re-encodes every block at its narrowest width into a fresh pool.
+    void repack() {
+        PROF_SCOPE(PackedSafeArray, "repack");
+        vector<uint32_t> old;
+        old.swap(words);
+        words.assign(4, 0);
+        wasted = 0;
+        int buf[blockSize];
+        for (int b = 0; b < (int)blocks.size(); b++) {
+            Block& blk = blocks[b];
+            if (blk.bits == 0) std::fill(buf, buf + blockSize, blk.base);
+            else decodeLanes(old.data() + blk.offset, blk.bits, blk.base, buf);
+            blk.capacity = 0;
+            encodeBlock(b, buf);
+        }
+        words.shrink_to_fit();
+    }
+};
+
+#ifndef HOMEWORK_NO_MAIN
+// Failed self-checks and unexpected exceptions in the tests below; main
+// exits nonzero if there were any.
+int failedChecks = 0;
+
+bool selfCheck(bool ok) {
+    if (!ok) failedChecks++;
+    return ok;
+}
+
 int main() {
     cout << "Testing SafeArray\n" << endl;
     
@@ -103,6 +972,7 @@ int main() {
         cout << "a2[1] = " << a2[1] << "\n" << endl;
     } catch (const exception& e) {
         cout << "Error: " << e.what() << endl;
+        failedChecks++;
     }
     
     try {
@@ -121,15 +991,18 @@ int main() {
         cout << "a5[2] = " << a5[2] << "\n" << endl;
     } catch (const exception& e) {
         cout << "Error: " << e.what() << endl;
+        failedChecks++;
     }
     
     try {
         cout << "Test 5: Resize too big" << endl;
+        SafeArray::setMaxSize(1000);
         SafeArray a6(10);
         a6.resize(2000);
     } catch (const length_error& e) {
         cout << "Got error: " << e.what() << "\n" << endl;
     }
+    SafeArray::setMaxSize(INT_MAX);
     
     try {
         cout << "Test 6: Good resize" << endl;
@@ -142,6 +1015,7 @@ int main() {
         cout << "a7[4] = " << a7[4] << "\n" << endl;
     } catch (const exception& e) {
         cout << "Error: " << e.what() << endl;
+        failedChecks++;
     }
     
     try {
@@ -155,8 +1029,155 @@ int main() {
         cout << "a9[1] = " << a9[1] << "\n" << endl;
     } catch (const exception& e) {
         cout << "Error: " << e.what() << endl;
+        failedChecks++;
+    }
+    
+    try {
+        cout << "Test 8: Mmap storage" << endl;
+        SafeArray a10(1000, Storage::Anonymous);
+        a10[999] = 5;
+        a10.resize(5000);
+        a10[4999] = 6;
+        a10.resize(10);
+        a10.resize(1000);
+        cout << "a10[4] = " << a10[4] << ", a10[999] = " << a10[999] << endl;
+        a10.resize(0);
+        cout << "after resize(0): size " << a10.size();
+        a10.resize(3);
+        cout << ", regrown a10[2] = " << a10[2] << "\n" << endl;
+    } catch (const exception& e) {
+        cout << "Error: " << e.what() << endl;
+        failedChecks++;
+    }
+    
+    try {
+        cout << "Test 9: File storage" << endl;
+        {
+            SafeArray a11(100, Storage::File, "safearray_test.bin");
+            a11[42] = 4242;
+            a11.flush();
+        }
+        SafeArray a12(100, Storage::File, "safearray_test.bin");
+        cout << "Reopened a12[42] = " << a12[42] << endl;
+        a12.resize(0);
+        a12.resize(50);
+        cout << "after resize(0) and regrow: a12[42] = " << a12[42] << "\n" << endl;
+        remove("safearray_test.bin");
+    } catch (const exception& e) {
+        cout << "Error: " << e.what() << endl;
+        failedChecks++;
+    }
+    
+    try {
+        cout << "Test 10: Parallel algorithms" << endl;
+        SafeArray a13(100000);
+        for (int i = 0; i < a13.size(); i++) {
+            a13[i] = (i * 7919) % 100000;
+        }
+        a13.sort();
+        cout << "sorted a13[0] = " << a13[0] << ", a13[99999] = " << a13[99999] << endl;
+        cout << "sum = " << a13.reduce(0LL, [](long long s, long long x) { return s + x; }) << endl;
+        cout << "find(500) = " << a13.find(500) << endl;
+        a13.fill(1);
+        a13.inclusiveScan([](int x, int y) { return x + y; });
+        cout << "scan a13[99999] = " << a13[99999] << endl;
+        a13.transform([](int x) { return x * 2; });
+        cout << "transform a13[9] = " << a13[9] << endl;
+        SafeArray empty(4);
+        empty.resize(0);
+        long long emptySum = empty.reduce(5LL, [](long long s, long long x) { return s + x; });
+        empty.inclusiveScan([](int x, int y) { return x + y; });
+        cout << "empty: reduce = " << emptySum << ", find(0) = " << empty.find(0)
+             << ", size after scan = " << empty.size() << endl;
+        ThreadPool small(1);
+        TaskGroup outer(ThreadPool::shared());
+        atomic<int> ran(0);
+        for (int i = 0; i < 8; i++) {
+            outer.run([&] {
+                TaskGroup inner(small);
+                inner.run([&] { ran++; });
+                inner.wait();
+            });
+        }
+        outer.wait();
+        cout << "tasks submitted across pools: " << ran << "\n" << endl;
+    } catch (const exception& e) {
+        cout << "Error: " << e.what() << endl;
+        failedChecks++;
+    }
+    
+    try {
+        cout << "Test 11: Copy on write" << endl;
+        SafeArray a14(5);
+        a14.fill(3);
+        SafeArray a15 = a14;
+        cout << "shared after copy: " << (a14.isShared() ? "yes" : "no") << endl;
+        a15[0] = 100;
+        cout << "shared after write: " << (a14.isShared() ? "yes" : "no") << endl;
+        cout << "a14[0] = " << a14[0] << ", a15[0] = " << a15[0] << "\n" << endl;
+    } catch (const exception& e) {
+        cout << "Error: " << e.what() << endl;
+        failedChecks++;
+    }
+    
+    try {
+        cout << "Test 12: Reference taken before a copy" << endl;
+        SafeArray a16(4);
+        a16.fill(1);
+        int& r = a16[0];
+        SafeArray snap = a16;
+        r = 9;
+        cout << "a16[0] = " << a16[0] << ", snap[0] = " << snap[0] << endl;
+        SafeArray a17(4);
+        a17.set(0, 5);
+        SafeArray a18 = a17;
+        cout << "copy after set() shares: " << (selfCheck(a17.isShared()) ? "yes" : "no") << endl;
+        SafeArray live(1000);
+        live[0] = 1;
+        SafeArray snap1 = live;
+        cout << "copy after operator[] shares: " << (live.isShared() ? "yes" : "no");
+        live.fill(2);
+        SafeArray snap2 = live;
+        cout << ", after fill: " << (selfCheck(live.isShared()) ? "yes" : "no") << "\n" << endl;
+    } catch (const exception& e) {
+        cout << "Error: " << e.what() << endl;
+        failedChecks++;
+    }
+    
+    try {
+        cout << "Test 13: Packed storage" << endl;
+        const int n = 100000;
+        vector<int> counters(n);
+        for (int i = 0; i < n; i++) {
+            counters[i] = (i * 7919) % 4096;
+        }
+        PackedSafeArray p1(counters.data(), n);
+        cout << "plain " << n * sizeof(int) << " bytes, packed " << p1.bytes() << " bytes" << endl;
+        long long sum = accumulate(counters.begin(), counters.end(), 0LL);
+        cout << "sums match: " << (selfCheck(p1.reduce(0LL, [](long long s, int x) { return s + x; }) == sum) ? "yes" : "no") << endl;
+        p1[5] = 4000;
+        p1[6] += 1;
+        p1[7] = -123456789;
+        p1[99999] = INT_MAX;
+        cout << "p1[5] = " << p1[5] << ", p1[6] = " << p1[6] << ", p1[7] = " << p1[7]
+             << ", p1[99999] = " << p1[99999] << endl;
+        vector<int> back(n);
+        p1.copyTo(back.data());
+        counters[5] = 4000;
+        counters[6] += 1;
+        counters[7] = -123456789;
+        counters[99999] = INT_MAX;
+        cout << "round trip after widening: " << (selfCheck(back == counters) ? "ok" : "MISMATCH") << endl;
+        SafeArray plain = p1.unpack();
+        SafeArray plainCopy = plain;
+        cout << "copy of unpacked shares: " << (selfCheck(plain.isShared()) ? "yes" : "no") << endl;
+        cout << "unpacked[7] = " << plain[7] << endl;
+        p1[n] = 1;
+    } catch (const out_of_range& e) {
+        cout << "Got error: " << e.what() << "\n" << endl;
     }
     
     cout << "All tests done" << endl;
-    return 0;
-}
\ No newline at end of file
+    return failedChecks == 0 ? 0 : 1;
+}
+#endif
\ No newline at end of file
@@ -1,35 +1,182 @@
 #include <iostream>
 #include <stdexcept>
+#include <string>
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <mutex>
+#include <vector>
+#include <memory>
+#include <new>
+#include <utility>
+#include <cstring>
+#include <type_traits>
+#include <exception>
+#include "profiler.h"
 using namespace std;
 
+template<typename T, bool Trivial = is_trivially_copyable<T>::value>
+struct RangeOps {
+    static void copyIn(T* dst, const T* src, int n) {
+        int i = 0;
+        try {
+            for (; i < n; i++) {
+                new (dst + i) T(src[i]);
+            }
+        } catch (...) {
+            while (i > 0) dst[--i].~T();
+            throw;
+        }
+    }
+    
+    static void moveOut(T* dst, T* src, int n) {
+        for (int i = 0; i < n; i++) {
+            dst[i] = move(src[i]);
+            src[i].~T();
+        }
+    }
+};
+
+template<typename T>
+struct RangeOps<T, true> {
+    static void copyIn(T* dst, const T* src, int n) {
+        if (n > 0) memcpy(static_cast<void*>(dst), src, n * sizeof(T));
+    }
+    
+    static void moveOut(T* dst, T* src, int n) {
+        if (n > 0) memcpy(static_cast<void*>(dst), src, n * sizeof(T));
+    }
+};
+
 template<typename T, int Capacity>
-class Stack {
+class Stack : prof::Tracked<Stack<T, Capacity>> {
 private:
-    T data[Capacity];
+    // raw storage: only slots 0..topIndex hold live objects
+    alignas(T) unsigned char data[sizeof(T) * Capacity];
     int topIndex;
     
+    T* slot(int i) {
+        return reinterpret_cast<T*>(data) + i;
+    }
+    
+    const T* slot(int i) const {
+        return reinterpret_cast<const T*>(data) + i;
+    }
+    
 public:
     Stack() : topIndex(-1) {}
     
-    void push(const T& value) {
+    Stack(const Stack& other) : prof::Tracked<Stack>(other), topIndex(-1) {
+        try {
+            for (int i = 0; i <= other.topIndex; i++) {
+                emplace(*other.slot(i));
+            }
+        } catch (...) {
+            clear();
+            throw;
+        }
+    }
+    
+    Stack(Stack&& other) : prof::Tracked<Stack>(move(other)), topIndex(-1) {
+        try {
+            for (int i = 0; i <= other.topIndex; i++) {
+                emplace(move(*other.slot(i)));
+            }
+        } catch (...) {
+            clear();
+            throw;
+        }
+        other.clear();
+    }
+    
+    Stack& operator=(const Stack& other) {
+        if (this != &other) {
+            clear();
+            for (int i = 0; i <= other.topIndex; i++) {
+                emplace(*other.slot(i));
+            }
+        }
+        return *this;
+    }
+    
+    Stack& operator=(Stack&& other) {
+        if (this != &other) {
+            clear();
+            for (int i = 0; i <= other.topIndex; i++) {
+                emplace(move(*other.slot(i)));
+            }
+            other.clear();
+        }
+        return *this;
+    }
+    
+    ~Stack() {
+        clear();
+    }
+    
+    template<typename... Args>
+    T& emplace(Args&&... args) {
         if (full()) {
             throw overflow_error("Stack is full");
         }
-        data[++topIndex] = value;
+        T* p = new (slot(topIndex + 1)) T(forward<Args>(args)...);
+        ++topIndex;
+        return *p;
+    }
+    
+    void push(const T& value) {
+        emplace(value);
+    }
+    
+    void push(T&& value) {
+        emplace(move(value));
     }
     
     T pop() {
         if (empty()) {
             throw underflow_error("Stack is empty");
         }
-        return data[topIndex--];
+        T* p = slot(topIndex);
+        T value(move(*p));
+        p->~T();
+        --topIndex;
+        return value;
     }
     
     const T& top() const {
         if (empty()) {
             throw underflow_error("Stack is empty");
         }
-        return data[topIndex];
+        return *slot(topIndex);
+    }
+    
+    void clear() {
+        while (topIndex >= 0) {
+            slot(topIndex--)->~T();
+        }
+    }
+    
+    // values[n-1] ends up on top; popRange(out, n) gives the same order back
+    void pushRange(const T* values, int n) {
+        if (n < 0) {
+            throw invalid_argument("Negative range size");
+        }
+        if (n > Capacity - size()) {
+            throw overflow_error("Stack is full");
+        }
+        RangeOps<T>::copyIn(slot(topIndex + 1), values, n);
+        topIndex += n;
+    }
+    
+    void popRange(T* out, int n) {
+        if (n < 0) {
+            throw invalid_argument("Negative range size");
+        }
+        if (n > size()) {
+            throw underflow_error("Stack is empty");
+        }
+        RangeOps<T>::moveOut(out, slot(topIndex - n + 1), n);
+        topIndex -= n;
     }
     
     bool empty() const {
@@ -45,6 +192,489 @@ public:
     }
 };
 
+template<typename T, int Capacity, int SegmentSize = 1024>
+class HybridStack : prof::Tracked<HybridStack<T, Capacity, SegmentSize>> {
+private:
+    alignas(T) unsigned char inlineData[sizeof(T) * Capacity];
+    vector<T*> segments;
+    int block;
+    T* begin;
+    T* cur;
+    T* end;
+    
+    T* blockStart(int b) {
+        return b < 0 ? reinterpret_cast<T*>(inlineData) : segments[b];
+    }
+    
+    int blockSize(int b) const {
+        return b < 0 ? Capacity : SegmentSize;
+    }
+    
+    void enterBlock(int b, bool atEnd) {
+        block = b;
+        begin = blockStart(b);
+        end = begin + blockSize(b);
+        cur = atEnd ? end : begin;
+    }
+    
+    void nextBlock() {
+        if (block + 1 == (int)segments.size()) {
+            PROF_SCOPE(HybridStack, "spill");
+            segments.push_back(static_cast<T*>(::operator new(sizeof(T) * SegmentSize)));
+            prof::recordAlloc<HybridStack>(sizeof(T) * SegmentSize);
+        }
+        enterBlock(block + 1, false);
+    }
+    
+    void prevBlock() {
+        enterBlock(block - 1, true);
+    }
+    
+public:
+    HybridStack() : block(-1) {
+        enterBlock(-1, false);
+    }
+    
+    HybridStack(const HybridStack&) = delete;
+    HybridStack& operator=(const HybridStack&) = delete;
+    
+    ~HybridStack() {
+        clear();
+        for (T* seg : segments) {
+            ::operator delete(seg);
+            prof::recordFree<HybridStack>(sizeof(T) * SegmentSize);
+        }
+    }
+    
+    template<typename... Args>
+    T& emplace(Args&&... args) {
+        if (cur == end) nextBlock();
+        T* p = new (cur) T(forward<Args>(args)...);
+        ++cur;
+        return *p;
+    }
+    
+    void push(const T& value) {
+        emplace(value);
+    }
+    
+    void push(T&& value) {
+        emplace(move(value));
+    }
+    
+    T pop() {
+        if (cur == begin) {
+            if (block < 0) {
+                throw underflow_error("Stack is empty");
+            }
+            prevBlock();
+        }
+        --cur;
+        T value(move(*cur));
+        cur->~T();
+        return value;
+    }
+    
+    const T& top() const {
+        if (empty()) {
+            throw underflow_error("Stack is empty");
+        }
+        if (cur != begin) return cur[-1];
+        return block == 0 ? reinterpret_cast<const T*>(inlineData)[Capacity - 1]
+                                              : segments[block - 1][SegmentSize - 1];
+    }
+    
+    void pushRange(const T* values, int n) {
+        if (n < 0) {
+            throw invalid_argument("Negative range size");
+        }
+        while (n > 0) {
+            if (cur == end) nextBlock();
+            int chunk = min<long>(n, end - cur);
+            RangeOps<T>::copyIn(cur, values, chunk);
+            cur += chunk;
+            values += chunk;
+            n -= chunk;
+        }
+    }
+    
+    void popRange(T* out, int n) {
+        if (n < 0) {
+            throw invalid_argument("Negative range size");
+        }
+        if (n > size()) {
+            throw underflow_error("Stack is empty");
+        }
+        while (n > 0) {
+            if (cur == begin) prevBlock();
+            int chunk = min<long>(n, cur - begin);
+            cur -= chunk;
+            n -= chunk;
+            RangeOps<T>::moveOut(out + n, cur, chunk);
+        }
+    }
+    
+    void clear() {
+        while (!empty()) {
+            if (cur == begin) prevBlock();
+            (--cur)->~T();
+        }
+    }
+    
+    // spilled segments stay pooled for reuse until this is called
+    void shrinkToFit() {
+        while ((int)segments.size() > block + 1) {
+            ::operator delete(segments.back());
+            prof::recordFree<HybridStack>(sizeof(T) * SegmentSize);
+            segments.pop_back();
+        }
+    }
+    
+    bool empty() const {
+        return cur == begin && block < 0;
+    }
+    
+    bool spilled() const {
+        return size() > Capacity;
+    }
+    
+    int size() const {
+        int below = block < 0 ? 0 : Capacity + block * SegmentSize;
+        return below + (cur - begin);
+    }
+};
+
+template<typename T, int Capacity>
+class ConcurrentStack {
+private:
+    static const uint32_t NONE = 0xFFFFFFFFu;
+    
+    struct Node {
+        T value;
+        atomic<uint32_t> next;
+    };
+    
+    // list heads pack a node index with a tag bumped on every change (ABA guard)
+    Node nodes[Capacity];
+    atomic<uint64_t> head;
+    atomic<uint64_t> freeList;
+    atomic<int> count;
+    
+    static uint64_t pack(uint32_t index, uint64_t tag) {
+        return (tag << 32) | index;
+    }
+    
+    static uint32_t indexOf(uint64_t h) {
+        return (uint32_t)h;
+    }
+    
+    static uint64_t tagOf(uint64_t h) {
+        return h >> 32;
+    }
+    
+    void pushChain(atomic<uint64_t>& list, uint32_t first, uint32_t last) {
+        uint64_t old = list.load(memory_order_relaxed);
+        do {
+            nodes[last].next.store(indexOf(old), memory_order_relaxed);
+        } while (!list.compare_exchange_weak(old, pack(first, tagOf(old) + 1),
+                                             memory_order_release, memory_order_relaxed));
+    }
+    
+    int popChain(atomic<uint64_t>& list, int n, uint32_t& first) {
+        uint64_t old = list.load(memory_order_acquire);
+        while (true) {
+            first = indexOf(old);
+            if (first == NONE) return 0;
+            int taken = 1;
+            uint32_t last = first;
+            uint32_t rest = nodes[last].next.load(memory_order_relaxed);
+            while (taken < n && rest != NONE && rest < (uint32_t)Capacity) {
+                last = rest;
+                rest = nodes[last].next.load(memory_order_relaxed);
+                taken++;
+            }
+            if (list.compare_exchange_weak(old, pack(rest, tagOf(old) + 1),
+                                           memory_order_acq_rel, memory_order_acquire)) {
+                nodes[last].next.store(NONE, memory_order_relaxed);
+                return taken;
+            }
+        }
+    }
+    
+public:
+    ConcurrentStack() : head(pack(NONE, 0)), freeList(pack(0, 0)), count(0) {
+        for (int i = 0; i < Capacity; i++) {
+            nodes[i].next.store(i + 1 < Capacity ? i + 1 : NONE, memory_order_relaxed);
+        }
+    }
+    
+    ConcurrentStack(const ConcurrentStack&) = delete;
+    ConcurrentStack& operator=(const ConcurrentStack&) = delete;
+    
+    bool tryPush(const T& value) {
+        uint32_t idx;
+        if (popChain(freeList, 1, idx) == 0) return false;
+        nodes[idx].value = value;
+        pushChain(head, idx, idx);
+        count++;
+        return true;
+    }
+    
+    bool tryPop(T& out) {
+        uint32_t idx;
+        if (popChain(head, 1, idx) == 0) return false;
+        out = move(nodes[idx].value);
+        count--;
+        pushChain(freeList, idx, idx);
+        return true;
+    }
+    
+    void push(const T& value) {
+        if (!tryPush(value)) {
+            throw overflow_error("Stack is full");
+        }
+    }
+    
+    T pop() {
+        T value;
+        if (!tryPop(value)) {
+            throw underflow_error("Stack is empty");
+        }
+        return value;
+    }
+    
+    // pushes as many of values[0..n) as fit, values[n-1] ends up on top
+    int pushBatch(const T* values, int n) {
+        uint32_t first;
+        int taken = n > 0 ? popChain(freeList, n, first) : 0;
+        if (taken == 0) return 0;
+        uint32_t idx = first, last = first;
+        for (int i = taken - 1; i >= 0; i--) {
+            nodes[idx].value = values[i];
+            last = idx;
+            idx = nodes[idx].next.load(memory_order_relaxed);
+        }
+        pushChain(head, first, last);
+        count += taken;
+        return taken;
+    }
+    
+    // pops up to n values, top first
+    int popBatch(T* out, int n) {
+        uint32_t first;
+        int taken = n > 0 ? popChain(head, n, first) : 0;
+        if (taken == 0) return 0;
+        uint32_t idx = first, last = first;
+        for (int i = 0; i < taken; i++) {
+            out[i] = move(nodes[idx].value);
+            last = idx;
+            idx = nodes[idx].next.load(memory_order_relaxed);
+        }
+        count -= taken;
+        pushChain(freeList, first, last);
+        return taken;
+    }
+    
+    bool empty() const {
+        return indexOf(head.load(memory_order_acquire)) == NONE;
+    }
+    
+    bool full() const {
+        return indexOf(freeList.load(memory_order_acquire)) == NONE;
+    }
+    
+    int size() const {
+        return count.load(memory_order_relaxed);
+    }
+};
+
+// Chase-Lev deque: the owner pushes and pops at the bottom, thieves steal from the top
+template<typename T, int Capacity>
+class WorkStealingDeque {
+private:
+    static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+    static_assert(is_trivially_copyable<T>::value, "T must be trivially copyable");
+    
+    alignas(64) atomic<long> top;
+    alignas(64) atomic<long> bottom;
+    atomic<T> slots[Capacity];
+    
+public:
+    WorkStealingDeque() : top(0), bottom(0) {}
+    
+    WorkStealingDeque(const WorkStealingDeque&) = delete;
+    WorkStealingDeque& operator=(const WorkStealingDeque&) = delete;
+    
+    bool tryPush(const T& value) {
+        long b = bottom.load(memory_order_relaxed);
+        long t = top.load(memory_order_acquire);
+        if (b - t >= Capacity) return false;
+        slots[b & (Capacity - 1)].store(value, memory_order_relaxed);
+        bottom.store(b + 1, memory_order_release);
+        return true;
+    }
+    
+    // The bottom store and top load here, and the two loads in trySteal,
+    // are seq_cst operations rather than relaxed ones around a fence: same
+    // ordering, and ThreadSanitizer understands it (it ignores fences).
+    bool tryPop(T& out) {
+        long b = bottom.load(memory_order_relaxed) - 1;
+        bottom.store(b, memory_order_seq_cst);
+        long t = top.load(memory_order_seq_cst);
+        if (t > b) {
+            bottom.store(b + 1, memory_order_release);
+            return false;
+        }
+        out = slots[b & (Capacity - 1)].load(memory_order_relaxed);
+        if (t == b) {
+            bool won = top.compare_exchange_strong(t, t + 1, memory_order_seq_cst, memory_order_relaxed);
+            bottom.store(b + 1, memory_order_release);
+            return won;
+        }
+        return true;
+    }
+    
+    bool trySteal(T& out) {
+        long t = top.load(memory_order_seq_cst);
+        long b = bottom.load(memory_order_seq_cst);
+        if (t >= b) return false;
+        out = slots[t & (Capacity - 1)].load(memory_order_relaxed);
+        return top.compare_exchange_strong(t, t + 1, memory_order_seq_cst, memory_order_relaxed);
+    }
+    
+    bool empty() const {
+        return bottom.load(memory_order_relaxed) <= top.load(memory_order_relaxed);
+    }
+    
+    int size() const {
+        long n = bottom.load(memory_order_relaxed) - top.load(memory_order_relaxed);
+        return n < 0 ? 0 : n;
+    }
+};
+
+template<typename Task, int Capacity = 4096>
+class TaskScheduler {
+public:
+    class Worker {
+        friend class TaskScheduler;
+        
+        TaskScheduler* owner;
+        int index;
+        unsigned seed;
+        WorkStealingDeque<Task, Capacity> deque;
+        
+    public:
+        int id() const {
+            return index;
+        }
+        
+        void spawn(const Task& task) {
+            owner->pending.fetch_add(1, memory_order_relaxed);
+            if (!deque.tryPush(task)) {
+                // deque full: run the task right here instead of failing
+                owner->execute(task, *this);
+            }
+        }
+    };
+    
+private:
+    vector<unique_ptr<Worker>> workers;
+    atomic<long> pending;
+    atomic<bool> stopped;
+    mutex errorLock;
+    exception_ptr error;
+    void* handler;
+    void (*invoke)(void*, const Task&, Worker&);
+    
+    void execute(const Task& task, Worker& w) {
+        invoke(handler, task, w);
+        pending.fetch_sub(1, memory_order_acq_rel);
+    }
+    
+    // Keeps the first exception and tells every worker to stop.
+    void fail(exception_ptr e) {
+        lock_guard<mutex> lock(errorLock);
+        if (!error) error = e;
+        stopped.store(true, memory_order_release);
+    }
+    
+    void runTask(const Task& task, Worker& w) {
+        try {
+            execute(task, w);
+        } catch (...) {
+            fail(current_exception());
+        }
+    }
+    
+    void work(Worker& w) {
+        Task task;
+        int n = workers.size();
+        while (pending.load(memory_order_acquire) > 0 && !stopped.load(memory_order_acquire)) {
+            if (w.deque.tryPop(task)) {
+                runTask(task, w);
+                continue;
+            }
+            w.seed = w.seed * 1103515245u + 12345u;
+            Worker& victim = *workers[(w.seed >> 16) % n];
+            if (&victim != &w && victim.deque.trySteal(task)) {
+                runTask(task, w);
+            } else {
+                this_thread::yield();
+            }
+        }
+    }
+    
+public:
+    explicit TaskScheduler(int threads) : pending(0), stopped(false), handler(nullptr), invoke(nullptr) {
+        for (int i = 0; i < max(1, threads); i++) {
+            workers.push_back(make_unique<Worker>());
+            workers.back()->owner = this;
+            workers.back()->index = i;
+            workers.back()->seed = i * 2654435761u + 1;
+        }
+    }
+    
+    int size() const {
+        return workers.size();
+    }
+    
+    // handler(task, worker) may call worker.spawn(child); run returns when all
+    // tasks are done. If a handler throws, the workers stop, unfinished tasks
+    // are dropped and the first exception is rethrown here.
+    template<typename Handler>
+    void run(const Task& root, Handler&& h) {
+        typedef typename remove_reference<Handler>::type F;
+        handler = const_cast<void*>(static_cast<const void*>(&h));
+        invoke = [](void* f, const Task& task, Worker& w) { (*static_cast<F*>(f))(task, w); };
+        stopped.store(false, memory_order_relaxed);
+        error = nullptr;
+        workers[0]->spawn(root);
+        vector<thread> threads;
+        try {
+            for (int i = 1; i < (int)workers.size(); i++) {
+                threads.emplace_back([this, i] { work(*workers[i]); });
+            }
+        } catch (...) {
+            fail(current_exception());
+        }
+        work(*workers[0]);
+        for (thread& t : threads) {
+            t.join();
+        }
+        if (error) {
+            Task dropped;
+            for (auto& w : workers) {
+                while (w->deque.tryPop(dropped)) {}
+            }
+            pending.store(0, memory_order_relaxed);
+            exception_ptr e = error;
+            error = nullptr;
+            rethrow_exception(e);
+        }
+    }
+};
+
+#ifndef HOMEWORK_NO_MAIN
 int main() {
     cout << "=== Testing int Stack ===" << endl;
     Stack<int, 5> s1;
@@ -82,6 +712,11 @@ int main() {
         cout << "Pop: " << s2.pop() << endl;
     }
     
+    s2.emplace(5, '!');
+    string moved = "moved in";
+    s2.push(move(moved));
+    cout << "Emplaced then moved, top: " << s2.top() << ", size: " << s2.size() << endl;
+    
     cout << "\n=== Testing errors ===" << endl;
     Stack<double, 2> s3;
     
@@ -100,6 +735,20 @@ int main() {
         cout << "Error on push: " << e.what() << endl;
     }
     
+    Stack<string, 4> s8;
+    s8.push("only");
+    string rangeOut[2];
+    try {
+        s8.popRange(rangeOut, -2);
+    } catch (const invalid_argument& e) {
+        cout << "Error on popRange(-2): " << e.what() << ", size still " << s8.size() << endl;
+    }
+    try {
+        s8.pushRange(rangeOut, -1);
+    } catch (const invalid_argument& e) {
+        cout << "Error on pushRange(-1): " << e.what() << ", size still " << s8.size() << endl;
+    }
+    
     cout << "\n=== Testing full operations ===" << endl;
     Stack<char, 4> s4;
     
@@ -118,5 +767,101 @@ int main() {
     
     cout << "Empty? " << (s4.empty() ? "yes" : "no") << endl;
     
+    cout << "\n=== Testing hybrid Stack ===" << endl;
+    HybridStack<string, 2, 4> s6;
+    for (int i = 0; i < 11; i++) {
+        s6.push("item" + to_string(i));
+    }
+    cout << "Size: " << s6.size() << ", spilled? " << (s6.spilled() ? "yes" : "no") << endl;
+    cout << "Top: " << s6.top() << endl;
+    string range[3];
+    s6.popRange(range, 3);
+    cout << "Pop range: " << range[0] << " " << range[1] << " " << range[2] << endl;
+    while (s6.size() > 2) {
+        s6.pop();
+    }
+    cout << "Back inline? " << (s6.spilled() ? "no" : "yes") << ", top: " << s6.top() << endl;
+    
+    HybridStack<int, 4> s7;
+    int nums[10] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9 };
+    s7.pushRange(nums, 10);
+    int back[10];
+    s7.popRange(back, 10);
+    cout << "Trivial range round trip: " << back[0] << ".." << back[9] << endl;
+    
+    cout << "\n=== Testing work-stealing deque ===" << endl;
+    WorkStealingDeque<int, 8> d;
+    for (int i = 1; i <= 3; i++) {
+        d.tryPush(i);
+    }
+    int stolen = 0, popped = 0;
+    d.trySteal(stolen);
+    d.tryPop(popped);
+    cout << "Stolen (oldest): " << stolen << ", popped (newest): " << popped << ", left: " << d.size() << endl;
+    
+    TaskScheduler<int> scheduler(3);
+    atomic<int> visited(0);
+    auto countdown = [&](int depth, TaskScheduler<int>::Worker& w) {
+        visited++;
+        if (depth > 0) {
+            w.spawn(depth - 1);
+            w.spawn(depth - 1);
+        }
+    };
+    scheduler.run(9, countdown);
+    cout << "Scheduler visited " << visited << " tasks" << endl;
+    
+    try {
+        scheduler.run(12, [](int depth, TaskScheduler<int>::Worker& w) {
+            if (depth == 3) throw runtime_error("task failed at depth 3");
+            if (depth > 0) {
+                w.spawn(depth - 1);
+                w.spawn(depth - 1);
+            }
+        });
+    } catch (const runtime_error& e) {
+        cout << "Scheduler rethrew: " << e.what() << endl;
+    }
+    visited = 0;
+    scheduler.run(9, countdown);
+    cout << "Reused after failure, visited " << visited << " tasks" << endl;
+    
+    cout << "\n=== Testing concurrent Stack ===" << endl;
+    ConcurrentStack<int, 4000> s5;
+    
+    s5.push(1);
+    int batch[3] = { 2, 3, 4 };
+    cout << "Batch pushed: " << s5.pushBatch(batch, 3) << endl;
+    cout << "Pop: " << s5.pop() << endl;
+    
+    int out[2];
+    int got = s5.popBatch(out, 2);
+    cout << "Batch popped " << got << ": " << out[0] << " " << out[1] << endl;
+    
+    int v;
+    s5.tryPop(v);
+    cout << "Try pop on empty: " << (s5.tryPop(v) ? "ok" : "empty") << endl;
+    
+    vector<thread> workers;
+    for (int t = 0; t < 4; t++) {
+        workers.emplace_back([&s5, t] {
+            for (int i = 1; i <= 1000; i++) {
+                s5.push(t * 1000 + i);
+            }
+        });
+    }
+    for (thread& w : workers) {
+        w.join();
+    }
+    cout << "Size after 4 threads: " << s5.size() << ", full? " << (s5.full() ? "yes" : "no") << endl;
+    cout << "Try push when full: " << (s5.tryPush(0) ? "ok" : "full") << endl;
+    
+    long long sum = 0;
+    while (s5.tryPop(v)) {
+        sum += v;
+    }
+    cout << "Sum of popped: " << sum << endl;
+    
     return 0;
-}
\ No newline at end of file
+}
+#endif
\ No newline at end of file
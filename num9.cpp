@@ -1,8 +1,17 @@
 #include <iostream>
 #include <cmath>
+#include <vector>
+#include <thread>
+#include <algorithm>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#include "profiler.h"
 using namespace std;
 
-class Vector3D {
+class Matrix4;
+
+class Vector3D : prof::Tracked<Vector3D> {
 private:
     double x, y, z;
     mutable double cached_len;
@@ -10,6 +19,7 @@ private:
     static int count;
     
     friend class Vector3DTest;
+    friend void transformPoints(const Matrix4& m, vector<Vector3D>& points, int threads);
     
 public:
     Vector3D(double a = 0.0, double b = 0.0, double c = 0.0) 
@@ -18,10 +28,18 @@ public:
     }
     
     Vector3D(const Vector3D& other) 
-        : x(other.x), y(other.y), z(other.z), cache_ok(false) {
+        : prof::Tracked<Vector3D>(other), x(other.x), y(other.y), z(other.z), cache_ok(false) {
         count++;
     }
     
+    Vector3D& operator=(const Vector3D& other) {
+        x = other.x;
+        y = other.y;
+        z = other.z;
+        cache_ok = false;
+        return *this;
+    }
+    
     ~Vector3D() {
         count--;
     }
@@ -46,6 +64,14 @@ public:
         return a.x*b.x + a.y*b.y + a.z*b.z;
     }
     
+    static Vector3D cross(const Vector3D& a, const Vector3D& b) {
+        return Vector3D(a.y*b.z - a.z*b.y, a.z*b.x - a.x*b.z, a.x*b.y - a.y*b.x);
+    }
+    
+    double getX() const { return x; }
+    double getY() const { return y; }
+    double getZ() const { return z; }
+    
     bool operator()(double val) const {
         return fabs(x - val) < 0.00001 || 
                fabs(y - val) < 0.00001 || 
@@ -86,6 +112,328 @@ public:
 
 int Vector3D::count = 0;
 
+class Matrix3 {
+private:
+    double m[3][3];
+    
+public:
+    Matrix3() {
+        for (int r = 0; r < 3; r++)
+            for (int c = 0; c < 3; c++)
+                m[r][c] = r == c ? 1.0 : 0.0;
+    }
+    
+    Matrix3(double a, double b, double c,
+            double d, double e, double f,
+            double g, double h, double i) {
+        m[0][0] = a; m[0][1] = b; m[0][2] = c;
+        m[1][0] = d; m[1][1] = e; m[1][2] = f;
+        m[2][0] = g; m[2][1] = h; m[2][2] = i;
+    }
+    
+    static Matrix3 identity() {
+        return Matrix3();
+    }
+    
+    static Matrix3 scale(double sx, double sy, double sz) {
+        return Matrix3(sx, 0, 0, 0, sy, 0, 0, 0, sz);
+    }
+    
+    // Rotation by `angle` radians around `axis` (Rodrigues' formula)
+    static Matrix3 rotation(const Vector3D& axis, double angle) {
+        Vector3D u = axis.normalize();
+        double x = u.getX(), y = u.getY(), z = u.getZ();
+        double c = cos(angle), s = sin(angle), t = 1 - c;
+        return Matrix3(t*x*x + c,   t*x*y - s*z, t*x*z + s*y,
+                       t*x*y + s*z, t*y*y + c,   t*y*z - s*x,
+                       t*x*z - s*y, t*y*z + s*x, t*z*z + c);
+    }
+    
+    double operator()(int row, int col) const {
+        return m[row][col];
+    }
+    
+    Matrix3 operator*(const Matrix3& other) const {
+        Matrix3 out;
+        for (int r = 0; r < 3; r++)
+            for (int c = 0; c < 3; c++)
+                out.m[r][c] = m[r][0]*other.m[0][c] + m[r][1]*other.m[1][c] + m[r][2]*other.m[2][c];
+        return out;
+    }
+    
+    Vector3D operator*(const Vector3D& v) const {
+        return Vector3D(m[0][0]*v.getX() + m[0][1]*v.getY() + m[0][2]*v.getZ(),
+                        m[1][0]*v.getX() + m[1][1]*v.getY() + m[1][2]*v.getZ(),
+                        m[2][0]*v.getX() + m[2][1]*v.getY() + m[2][2]*v.getZ());
+    }
+    
+    Matrix3 transpose() const {
+        return Matrix3(m[0][0], m[1][0], m[2][0],
+                       m[0][1], m[1][1], m[2][1],
+                       m[0][2], m[1][2], m[2][2]);
+    }
+    
+    double determinant() const {
+        return m[0][0] * (m[1][1]*m[2][2] - m[1][2]*m[2][1])
+             - m[0][1] * (m[1][0]*m[2][2] - m[1][2]*m[2][0])
+             + m[0][2] * (m[1][0]*m[2][1] - m[1][1]*m[2][0]);
+    }
+    
+    bool operator==(const Matrix3& other) const {
+        for (int r = 0; r < 3; r++)
+            for (int c = 0; c < 3; c++)
+                if (fabs(m[r][c] - other.m[r][c]) >= 0.00001) return false;
+        return true;
+    }
+};
+
+// Affine transform: the bottom row is always (0, 0, 0, 1), so only the
+// top three rows are stored.
+class Matrix4 {
+private:
+    double m[3][4];
+    
+public:
+    Matrix4() : Matrix4(Matrix3()) {}
+    
+    Matrix4(const Matrix3& linear, const Vector3D& offset = Vector3D()) {
+        for (int r = 0; r < 3; r++)
+            for (int c = 0; c < 3; c++)
+                m[r][c] = linear(r, c);
+        m[0][3] = offset.getX();
+        m[1][3] = offset.getY();
+        m[2][3] = offset.getZ();
+    }
+    
+    static Matrix4 identity() {
+        return Matrix4();
+    }
+    
+    static Matrix4 translation(const Vector3D& offset) {
+        return Matrix4(Matrix3(), offset);
+    }
+    
+    double operator()(int row, int col) const {
+        if (row == 3) return col == 3 ? 1.0 : 0.0;
+        return m[row][col];
+    }
+    
+    Matrix3 linear() const {
+        return Matrix3(m[0][0], m[0][1], m[0][2],
+                       m[1][0], m[1][1], m[1][2],
+                       m[2][0], m[2][1], m[2][2]);
+    }
+    
+    Vector3D offset() const {
+        return Vector3D(m[0][3], m[1][3], m[2][3]);
+    }
+    
+    Matrix4 operator*(const Matrix4& other) const {
+        return Matrix4(linear() * other.linear(), linear() * other.offset() + offset());
+    }
+    
+    Vector3D transformPoint(const Vector3D& p) const {
+        return linear() * p + offset();
+    }
+    
+    Vector3D transformDirection(const Vector3D& d) const {
+        return linear() * d;
+    }
+};
+
+class Quaternion {
+private:
+    double w, x, y, z;
+    
+public:
+    Quaternion(double w = 1.0, double x = 0.0, double y = 0.0, double z = 0.0)
+        : w(w), x(x), y(y), z(z) {}
+        
+    static Quaternion fromAxisAngle(const Vector3D& axis, double angle) {
+        Vector3D u = axis.normalize();
+        double s = sin(angle / 2);
+        return Quaternion(cos(angle / 2), u.getX() * s, u.getY() * s, u.getZ() * s);
+    }
+    
+    Quaternion operator*(const Quaternion& q) const {
+        return Quaternion(w*q.w - x*q.x - y*q.y - z*q.z,
+                          w*q.x + x*q.w + y*q.z - z*q.y,
+                          w*q.y - x*q.z + y*q.w + z*q.x,
+                          w*q.z + x*q.y - y*q.x + z*q.w);
+    }
+    
+    Quaternion conjugate() const {
+        return Quaternion(w, -x, -y, -z);
+    }
+    
+    double norm() const {
+        return sqrt(w*w + x*x + y*y + z*z);
+    }
+    
+    Quaternion normalize() const {
+        double n = norm();
+        if (n < 0.000001) {
+            return Quaternion();
+        }
+        return Quaternion(w/n, x/n, y/n, z/n);
+    }
+    
+    // v' = v + 2w(u x v) + 2u x (u x v), with u the vector part
+    Vector3D rotate(const Vector3D& v) const {
+        Vector3D u(x, y, z);
+        Vector3D t = Vector3D::cross(u, v) * 2;
+        return v + t * w + Vector3D::cross(u, t);
+    }
+    
+    Matrix3 toMatrix() const {
+        return Matrix3(1 - 2*(y*y + z*z), 2*(x*y - w*z),     2*(x*z + w*y),
+                       2*(x*y + w*z),     1 - 2*(x*x + z*z), 2*(y*z - w*x),
+                       2*(x*z - w*y),     2*(y*z + w*x),     1 - 2*(x*x + y*y));
+    }
+    
+    friend ostream& operator<<(ostream& os, const Quaternion& q) {
+        os << "(" << q.w << ", " << q.x << ", " << q.y << ", " << q.z << ")";
+        return os;
+    }
+};
+
+// Runs chunk(0..chunks-1), chunk 0 on the caller and the rest on their own
+// threads. A chunk whose thread cannot be started runs on the caller
+// instead, so a failed start never leaves a joinable thread to unwind past.
+template<typename F>
+void runChunks(int chunks, F chunk) {
+    vector<thread> workers;
+    int started = 1;
+    try {
+        workers.reserve(chunks - 1);
+        for (; started < chunks; started++) {
+            workers.emplace_back(chunk, started);
+        }
+    } catch (...) {
+        // the chunks from `started` on run below instead
+    }
+    for (int t = started; t < chunks; t++) {
+        chunk(t);
+    }
+    chunk(0);
+    for (thread& w : workers) w.join();
+}
+
+// Structure-of-arrays point set for batched transforms: each coordinate
+// lives in its own contiguous array so the kernel can load two points per
+// SSE2 register instead of gathering fields out of Vector3D objects.
+class PointBatch {
+private:
+    vector<double> xs, ys, zs;
+    
+    static void transformRange(const Matrix4& m, double* xs, double* ys, double* zs, size_t lo, size_t hi) {
+        size_t i = lo;
+#ifdef __SSE2__
+        __m128d m00 = _mm_set1_pd(m(0, 0)), m01 = _mm_set1_pd(m(0, 1)), m02 = _mm_set1_pd(m(0, 2)), m03 = _mm_set1_pd(m(0, 3));
+        __m128d m10 = _mm_set1_pd(m(1, 0)), m11 = _mm_set1_pd(m(1, 1)), m12 = _mm_set1_pd(m(1, 2)), m13 = _mm_set1_pd(m(1, 3));
+        __m128d m20 = _mm_set1_pd(m(2, 0)), m21 = _mm_set1_pd(m(2, 1)), m22 = _mm_set1_pd(m(2, 2)), m23 = _mm_set1_pd(m(2, 3));
+        for (; i + 2 <= hi; i += 2) {
+            __m128d x = _mm_loadu_pd(xs + i);
+            __m128d y = _mm_loadu_pd(ys + i);
+            __m128d z = _mm_loadu_pd(zs + i);
+            _mm_storeu_pd(xs + i, _mm_add_pd(_mm_add_pd(_mm_mul_pd(m00, x), _mm_mul_pd(m01, y)), _mm_add_pd(_mm_mul_pd(m02, z), m03)));
+            _mm_storeu_pd(ys + i, _mm_add_pd(_mm_add_pd(_mm_mul_pd(m10, x), _mm_mul_pd(m11, y)), _mm_add_pd(_mm_mul_pd(m12, z), m13)));
+            _mm_storeu_pd(zs + i, _mm_add_pd(_mm_add_pd(_mm_mul_pd(m20, x), _mm_mul_pd(m21, y)), _mm_add_pd(_mm_mul_pd(m22, z), m23)));
+        }
+#endif
+        for (; i < hi; i++) {
+            double x = xs[i], y = ys[i], z = zs[i];
+            xs[i] = m(0, 0)*x + m(0, 1)*y + m(0, 2)*z + m(0, 3);
+            ys[i] = m(1, 0)*x + m(1, 1)*y + m(1, 2)*z + m(1, 3);
+            zs[i] = m(2, 0)*x + m(2, 1)*y + m(2, 2)*z + m(2, 3);
+        }
+    }
+    
+public:
+    PointBatch() {}
+    
+    explicit PointBatch(const vector<Vector3D>& points) {
+        reserve(points.size());
+        for (const Vector3D& p : points) add(p);
+    }
+    
+    void reserve(size_t n) {
+        xs.reserve(n);
+        ys.reserve(n);
+        zs.reserve(n);
+    }
+    
+    void add(const Vector3D& p) {
+        xs.push_back(p.getX());
+        ys.push_back(p.getY());
+        zs.push_back(p.getZ());
+    }
+    
+    Vector3D get(size_t i) const {
+        return Vector3D(xs[i], ys[i], zs[i]);
+    }
+    
+    size_t size() const {
+        return xs.size();
+    }
+    
+    // Applies m to every point in place, split into contiguous chunks over
+    // `threads` threads (0 = one per core). Small batches stay on the caller.
+    void transform(const Matrix4& m, int threads = 0) {
+        const size_t minChunk = 16384;
+        size_t n = size();
+        if (threads <= 0) threads = max(1u, thread::hardware_concurrency());
+        threads = (int)min<size_t>(threads, max<size_t>(1, n / minChunk));
+        if (threads == 1) {
+            transformRange(m, xs.data(), ys.data(), zs.data(), 0, n);
+            return;
+        }
+        auto chunk = [=, &m](int t) {
+            // keep chunk borders even so every chunk but the last stays SIMD-only
+            size_t lo = (n * t / threads) & ~(size_t)1;
+            size_t hi = t + 1 == threads ? n : (n * (t + 1) / threads) & ~(size_t)1;
+            transformRange(m, xs.data(), ys.data(), zs.data(), lo, hi);
+        };
+        runChunks(threads, chunk);
+    }
+    
+    void rotate(const Quaternion& q, int threads = 0) {
+        transform(Matrix4(q.normalize().toMatrix()), threads);
+    }
+};
+
+// Transforms Vector3D objects in place. The fields are written directly so
+// no temporaries are built (Vector3D's instance count is not thread-safe).
+void transformPoints(const Matrix4& m, vector<Vector3D>& points, int threads = 0) {
+    const size_t minChunk = 16384;
+    size_t n = points.size();
+    if (threads <= 0) threads = max(1u, thread::hardware_concurrency());
+    threads = (int)min<size_t>(threads, max<size_t>(1, n / minChunk));
+    auto work = [&m, &points](size_t lo, size_t hi) {
+        for (size_t i = lo; i < hi; i++) {
+            Vector3D& p = points[i];
+            double x = p.x, y = p.y, z = p.z;
+            p.x = m(0, 0)*x + m(0, 1)*y + m(0, 2)*z + m(0, 3);
+            p.y = m(1, 0)*x + m(1, 1)*y + m(1, 2)*z + m(1, 3);
+            p.z = m(2, 0)*x + m(2, 1)*y + m(2, 2)*z + m(2, 3);
+            p.cache_ok = false;
+        }
+    };
+    if (threads == 1) {
+        work(0, n);
+        return;
+    }
+    runChunks(threads, [&work, n, threads](int t) { work(n * t / threads, n * (t + 1) / threads); });
+}
+
+// Failed checks in Vector3DTest; a nonzero count makes main fail.
+int failedChecks = 0;
+
+bool selfCheck(bool ok) {
+    if (!ok) failedChecks++;
+    return ok;
+}
+
 class Vector3DTest {
 public:
     static void testCount() {
@@ -162,6 +510,73 @@ public:
         cout << "Vector " << v << " has 10? " << (v(10) ? "yes" : "no") << endl;
     }
     
+    static void testCross() {
+        cout << "\nTest cross product..." << endl;
+        Vector3D x(1, 0, 0);
+        Vector3D y(0, 1, 0);
+        cout << x << " x " << y << " = " << Vector3D::cross(x, y) << endl;
+        Vector3D a(1, 2, 3);
+        Vector3D b(4, 5, 6);
+        Vector3D c = Vector3D::cross(a, b);
+        cout << a << " x " << b << " = " << c << endl;
+        cout << "Orthogonal to both? " << (fabs(Vector3D::dot(c, a)) < 1e-9 && fabs(Vector3D::dot(c, b)) < 1e-9 ? "yes" : "no") << endl;
+    }
+    
+    static void testTransforms() {
+        cout << "\nTest matrices and quaternions..." << endl;
+        const double pi = acos(-1.0);
+        Vector3D axis(0, 0, 1);
+        Vector3D v(1, 0, 0);
+        
+        Matrix3 rot = Matrix3::rotation(axis, pi / 2);
+        Quaternion q = Quaternion::fromAxisAngle(axis, pi / 2);
+        cout << "Matrix rotate " << v << " 90deg about z: " << rot * v << endl;
+        cout << "Quaternion " << q << " rotate: " << q.rotate(v) << endl;
+        cout << "Quaternion matrix == rotation matrix? " << (q.toMatrix() == rot ? "yes" : "no") << endl;
+        cout << "det(rotation) = " << rot.determinant() << endl;
+        cout << "R * R^T == I? " << (rot * rot.transpose() == Matrix3::identity() ? "yes" : "no") << endl;
+        
+        Quaternion half = Quaternion::fromAxisAngle(axis, pi / 4);
+        cout << "Two 45deg turns: " << (half * half).rotate(v) << endl;
+        
+        Matrix4 move = Matrix4::translation(Vector3D(10, 0, 0)) * Matrix4(rot);
+        cout << "Rotate then move " << v << ": " << move.transformPoint(v) << endl;
+        cout << "Direction ignores move: " << move.transformDirection(v) << endl;
+        
+        vector<Vector3D> points;
+        for (int i = 0; i < 5; i++) points.push_back(Vector3D(i, 1, 2));
+        PointBatch batch(points);
+        batch.transform(move, 2);
+        transformPoints(move, points, 2);
+        bool same = true;
+        for (size_t i = 0; i < points.size(); i++) {
+            if (batch.get(i) != points[i] || points[i] != move.transformPoint(Vector3D((double)i, 1, 2))) same = false;
+        }
+        cout << "Batch point 4: " << batch.get(4) << endl;
+        cout << "Batch, in-place and single transforms agree? " << (selfCheck(same) ? "yes" : "no") << endl;
+        
+        // large enough that the threaded paths really split the work
+        const int count = 3 * 16384 + 7;
+        vector<Vector3D> cloud;
+        for (int i = 0; i < count; i++) cloud.push_back(Vector3D(i % 101, i % 37 - 18, i * 0.5));
+        vector<Vector3D> serial = cloud;
+        transformPoints(move, serial, 1);
+        PointBatch big(cloud);
+        PointBatch bigSerial(cloud);
+        bigSerial.transform(move, 1);
+        for (int threads = 2; threads <= 4; threads++) {
+            vector<Vector3D> parallel = cloud;
+            transformPoints(move, parallel, threads);
+            PointBatch batchParallel = big;
+            batchParallel.transform(move, threads);
+            size_t bad = 0;
+            for (int i = 0; i < count; i++) {
+                if (parallel[i] != serial[i] || batchParallel.get(i) != bigSerial.get(i) || bigSerial.get(i) != serial[i]) bad++;
+            }
+            cout << count << " points on " << threads << " threads match serial? " << (selfCheck(bad == 0) ? "yes" : "no") << endl;
+        }
+    }
+    
     static void runAll() {
         cout << "=== Start tests ===" << endl;
         testCount();
@@ -171,10 +586,13 @@ public:
         testDot();
         testNormal();
         testFunctor();
+        testCross();
+        testTransforms();
         cout << "=== Tests done ===" << endl;
     }
 };
 
+#ifndef HOMEWORK_NO_MAIN
 int main() {
     cout << "Simple Vector3D demo\n" << endl;
     
@@ -206,5 +624,6 @@ int main() {
     cout << "\n";
     Vector3DTest::runAll();
     
-    return 0;
-}
\ No newline at end of file
+    return failedChecks == 0 ? 0 : 1;
+}
+#endif
\ No newline at end of file
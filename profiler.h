@@ -0,0 +1,450 @@
+#pragma once
+
+// Per-type lifetime, allocation and latency counters.
+//
+// A class opts in by deriving from prof::Tracked<Self> (copy and move
+// constructors should pass `other` on to it), reporting its heap traffic
+// with prof::recordAlloc/recordFree and timing hot members with PROF_SCOPE.
+// Without -DHOMEWORK_PROFILING every hook compiles to nothing.
+//
+// When enabled, a sample of lifetime events and allocations also records
+// its call stack (see setSampleEvery). prof::snapshot() returns the counters, prof::writeReport() prints
+// them and prof::writeFolded() writes the sampled stacks in the folded
+// format read by flamegraph.pl and speedscope. Setting HOMEWORK_PROFILE_OUT
+// writes the folded stacks to that file at exit.
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#ifdef HOMEWORK_PROFILING
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <typeinfo>
+#if defined(__GNUG__)
+#include <cxxabi.h>
+#endif
+#if defined(__GLIBC__)
+#include <execinfo.h>
+#endif
+#endif
+
+namespace prof {
+
+const int BUCKETS = 32;
+
+struct OpSnapshot {
+    std::string name;
+    long long calls;
+    double totalNs;
+    long long buckets[BUCKETS]; // bucket i counts calls taking [2^i, 2^(i+1)) ns
+};
+
+struct TypeSnapshot {
+    std::string name;
+    long long constructed, copied, moved, destroyed, live;
+    long long objectBytes;
+    long long heapAllocs, heapFrees, heapBytes, heapBytesLive;
+    std::vector<OpSnapshot> ops;
+};
+
+struct Snapshot {
+    double seconds;
+    std::vector<TypeSnapshot> types;
+};
+
+#ifdef HOMEWORK_PROFILING
+
+struct OpStats {
+    std::string name;
+    std::atomic<long long> calls{0};
+    std::atomic<long long> totalNs{0};
+    std::atomic<long long> buckets[BUCKETS] = {};
+    
+    void record(long long ns) {
+        int b = 0;
+        while (b < BUCKETS - 1 && (ns >> (b + 1)) > 0) b++;
+        calls.fetch_add(1, std::memory_order_relaxed);
+        totalNs.fetch_add(ns, std::memory_order_relaxed);
+        buckets[b].fetch_add(1, std::memory_order_relaxed);
+    }
+};
+
+enum Counter { CONSTRUCTED, COPIED, MOVED, DESTROYED, HEAP_ALLOCS, HEAP_FREES, HEAP_BYTES, HEAP_BYTES_FREED, COUNTERS };
+
+const int MAX_TYPES = 64;
+
+// Counters are per thread and only ever written by their own thread, so a
+// bump is a plain load and store; snapshots sum over all threads.
+struct ThreadCounters {
+    std::atomic<long long> c[MAX_TYPES][COUNTERS] = {};
+};
+
+struct TypeStats {
+    std::string name;
+    size_t objectSize;
+    int id;
+    std::mutex m;
+    std::vector<OpStats*> ops;
+    std::map<std::vector<void*>, long long> stacks;
+};
+
+class Registry {
+    std::mutex m;
+    std::vector<TypeStats*> types;
+    std::vector<ThreadCounters*> threads;
+    long long retired[MAX_TYPES][COUNTERS] = {};
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::atomic<int> every{4096};
+    std::atomic<long long> everyBytes{1 << 20};
+    
+public:
+    static Registry& instance() {
+        static Registry* r = new Registry; // never destroyed, so exit-time events stay safe
+        return *r;
+    }
+    
+    TypeStats& add(const std::string& name, size_t size) {
+        std::lock_guard<std::mutex> lock(m);
+        types.push_back(new TypeStats);
+        types.back()->name = name;
+        types.back()->objectSize = size;
+        types.back()->id = types.size() <= (size_t)MAX_TYPES ? (int)types.size() - 1 : -1;
+        return *types.back();
+    }
+    
+    OpStats& addOp(TypeStats& t, const char* name) {
+        std::lock_guard<std::mutex> lock(t.m);
+        t.ops.push_back(new OpStats);
+        t.ops.back()->name = name;
+        return *t.ops.back();
+    }
+    
+    void attach(ThreadCounters* tc) {
+        std::lock_guard<std::mutex> lock(m);
+        threads.push_back(tc);
+    }
+    
+    void detach(ThreadCounters* tc) {
+        std::lock_guard<std::mutex> lock(m);
+        for (int t = 0; t < MAX_TYPES; t++) {
+            for (int k = 0; k < COUNTERS; k++) retired[t][k] += tc->c[t][k].load(std::memory_order_relaxed);
+        }
+        for (size_t i = 0; i < threads.size(); i++) {
+            if (threads[i] == tc) {
+                threads.erase(threads.begin() + i);
+                break;
+            }
+        }
+    }
+    
+    long long total(int id, Counter k) {
+        std::lock_guard<std::mutex> lock(m);
+        long long sum = retired[id][k];
+        for (ThreadCounters* tc : threads) sum += tc->c[id][k].load(std::memory_order_relaxed);
+        return sum;
+    }
+    
+    int sampleEvery() const {
+        return every.load(std::memory_order_relaxed);
+    }
+    
+    long long sampleEveryBytes() const {
+        return everyBytes.load(std::memory_order_relaxed);
+    }
+    
+    void setSampleEvery(int events, long long bytes) {
+        every.store(events < 1 ? 1 : events, std::memory_order_relaxed);
+        everyBytes.store(bytes < 1 ? 1 : bytes, std::memory_order_relaxed);
+    }
+    
+    std::vector<TypeStats*> all() {
+        std::lock_guard<std::mutex> lock(m);
+        return types;
+    }
+    
+    double seconds() const {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+};
+
+struct ThreadSlot {
+    ThreadCounters counters;
+    int eventsLeft = 0;
+    long long bytesLeft = 0;
+    
+    ThreadSlot() {
+        Registry::instance().attach(&counters);
+    }
+    
+    ~ThreadSlot() {
+        Registry::instance().detach(&counters);
+    }
+};
+
+inline ThreadSlot& slot() {
+    thread_local ThreadSlot s;
+    return s;
+}
+
+inline void bump(const TypeStats& t, Counter k, long long n = 1) {
+    if (t.id < 0) return;
+    std::atomic<long long>& c = slot().counters.c[t.id][k];
+    c.store(c.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+inline std::string demangle(const char* mangled) {
+#if defined(__GNUG__)
+    int status = 0;
+    char* plain = abi::__cxa_demangle(mangled, nullptr, nullptr, &status);
+    if (status == 0 && plain) {
+        std::string out = plain;
+        std::free(plain);
+        return out;
+    }
+#endif
+    return mangled;
+}
+
+template<typename T>
+TypeStats& statsOf() {
+    static TypeStats& s = Registry::instance().add(demangle(typeid(T).name()), sizeof(T));
+    return s;
+}
+
+inline void sample(TypeStats& t) {
+#if defined(__GLIBC__)
+    void* frames[32];
+    int n = backtrace(frames, 32);
+    std::vector<void*> stack(frames, frames + n);
+    std::lock_guard<std::mutex> lock(t.m);
+    t.stacks[stack] += 1;
+#else
+    (void)t;
+#endif
+}
+
+// lifetime events are sampled by count, heap allocations by volume
+inline void countEvent(TypeStats& t, Counter k) {
+    bump(t, k);
+    ThreadSlot& s = slot();
+    if (--s.eventsLeft > 0) return;
+    s.eventsLeft = Registry::instance().sampleEvery();
+    sample(t);
+}
+
+template<typename T>
+class Tracked {
+public:
+    Tracked() {
+        countEvent(statsOf<T>(), CONSTRUCTED);
+    }
+    
+    Tracked(const Tracked&) {
+        countEvent(statsOf<T>(), COPIED);
+    }
+    
+    Tracked(Tracked&&) noexcept {
+        bump(statsOf<T>(), MOVED);
+    }
+    
+    Tracked& operator=(const Tracked&) = default;
+    Tracked& operator=(Tracked&&) = default;
+    
+    ~Tracked() {
+        bump(statsOf<T>(), DESTROYED);
+    }
+};
+
+template<typename T>
+void recordAlloc(size_t bytes) {
+    TypeStats& t = statsOf<T>();
+    bump(t, HEAP_ALLOCS);
+    bump(t, HEAP_BYTES, bytes);
+    ThreadSlot& s = slot();
+    s.bytesLeft -= bytes;
+    if (s.bytesLeft > 0) return;
+    s.bytesLeft = Registry::instance().sampleEveryBytes();
+    sample(t);
+}
+
+template<typename T>
+void recordFree(size_t bytes) {
+    TypeStats& t = statsOf<T>();
+    bump(t, HEAP_FREES);
+    bump(t, HEAP_BYTES_FREED, bytes);
+}
+
+template<typename T>
+OpStats& opOf(const char* name) {
+    return Registry::instance().addOp(statsOf<T>(), name);
+}
+
+class ScopedTimer {
+    OpStats& op;
+    std::chrono::steady_clock::time_point start;
+    
+public:
+    explicit ScopedTimer(OpStats& o) : op(o), start(std::chrono::steady_clock::now()) {}
+    
+    ~ScopedTimer() {
+        op.record(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count());
+    }
+};
+
+#define PROF_CAT2(a, b) a##b
+#define PROF_CAT(a, b) PROF_CAT2(a, b)
+#define PROF_SCOPE(Type, name) \
+    static ::prof::OpStats& PROF_CAT(profOp, __LINE__) = ::prof::opOf<Type>(name); \
+    ::prof::ScopedTimer PROF_CAT(profTimer, __LINE__)(PROF_CAT(profOp, __LINE__))
+    
+// capture the call stack of one lifetime event in `events` and of one
+// allocation per `bytes` allocated, per thread
+inline void setSampleEvery(int events, long long bytes) {
+    Registry::instance().setSampleEvery(events, bytes);
+}
+
+inline Snapshot snapshot() {
+    Snapshot snap;
+    snap.seconds = Registry::instance().seconds();
+    for (TypeStats* t : Registry::instance().all()) {
+        TypeSnapshot ts;
+        ts.name = t->name;
+        if (t->id < 0) continue;
+        Registry& r = Registry::instance();
+        ts.constructed = r.total(t->id, CONSTRUCTED);
+        ts.copied = r.total(t->id, COPIED);
+        ts.moved = r.total(t->id, MOVED);
+        ts.destroyed = r.total(t->id, DESTROYED);
+        ts.live = ts.constructed + ts.copied + ts.moved - ts.destroyed;
+        ts.objectBytes = ts.live * (long long)t->objectSize;
+        ts.heapAllocs = r.total(t->id, HEAP_ALLOCS);
+        ts.heapFrees = r.total(t->id, HEAP_FREES);
+        ts.heapBytes = r.total(t->id, HEAP_BYTES);
+        ts.heapBytesLive = ts.heapBytes - r.total(t->id, HEAP_BYTES_FREED);
+        std::lock_guard<std::mutex> lock(t->m);
+        for (OpStats* o : t->ops) {
+            OpSnapshot os;
+            os.name = o->name;
+            os.calls = o->calls.load();
+            os.totalNs = o->totalNs.load();
+            for (int b = 0; b < BUCKETS; b++) os.buckets[b] = o->buckets[b].load();
+            ts.ops.push_back(os);
+        }
+        snap.types.push_back(ts);
+    }
+    return snap;
+}
+
+inline void writeReport(std::ostream& out) {
+    Snapshot snap = snapshot();
+    out << "=== Profile after " << snap.seconds << " s ===" << std::endl;
+    for (const TypeSnapshot& t : snap.types) {
+        long long born = t.constructed + t.copied + t.moved;
+        out << t.name << ": created " << t.constructed << ", copied " << t.copied << ", moved " << t.moved
+            << ", live " << t.live << " (" << t.objectBytes << " bytes), "
+            << born / (snap.seconds > 0 ? snap.seconds : 1) << "/s" << std::endl;
+        if (t.heapAllocs > 0) {
+            out << "  heap: " << t.heapAllocs << " allocs, " << t.heapFrees << " frees, "
+                << t.heapBytes << " bytes total, " << t.heapBytesLive << " bytes live" << std::endl;
+        }
+        for (const OpSnapshot& o : t.ops) {
+            out << "  " << o.name << ": " << o.calls << " calls, mean "
+                << (o.calls ? o.totalNs / o.calls : 0) << " ns, histogram";
+            for (int b = 0; b < BUCKETS; b++) {
+                if (o.buckets[b]) out << " <" << (1LL << (b + 1)) << "ns:" << o.buckets[b];
+            }
+            out << std::endl;
+        }
+    }
+}
+
+inline std::string frameName(void* addr) {
+#if defined(__GLIBC__)
+    char** sym = backtrace_symbols(&addr, 1);
+    std::string s = sym ? sym[0] : "?";
+    std::free(sym);
+    // "dir/binary(mangled+0x1f) [0x...]" -> demangled name, or "binary+0x1f" when not exported
+    size_t open = s.find('('), plus = s.find('+', open), close = s.find(')', open);
+    if (open != std::string::npos && plus != std::string::npos && close != std::string::npos) {
+        if (plus > open + 1) {
+            s = demangle(s.substr(open + 1, plus - open - 1).c_str());
+        } else {
+            size_t slash = s.rfind('/', open);
+            size_t from = slash == std::string::npos ? 0 : slash + 1;
+            s = s.substr(from, open - from) + s.substr(plus, close - plus);
+        }
+    }
+    for (char& c : s) {
+        if (c == ';' || c == ' ') c = '_';
+    }
+    return s;
+#else
+    (void)addr;
+    return "?";
+#endif
+}
+
+inline void writeFolded(std::ostream& out) {
+    for (TypeStats* t : Registry::instance().all()) {
+        std::lock_guard<std::mutex> lock(t->m);
+        for (const auto& entry : t->stacks) {
+            std::string line;
+            for (auto it = entry.first.rbegin(); it != entry.first.rend(); ++it) {
+                std::string frame = frameName(*it);
+                if (frame.find("prof::") == std::string::npos) line += frame + ";";
+            }
+            line += t->name;
+            for (char& c : line) {
+                if (c == ' ') c = '_';
+            }
+            out << line << " " << entry.second << "\n";
+        }
+    }
+}
+
+struct ExitDump {
+    ~ExitDump() {
+        const char* path = std::getenv("HOMEWORK_PROFILE_OUT");
+        if (!path) return;
+        std::ofstream out(path);
+        writeFolded(out);
+        writeReport(std::cerr);
+    }
+};
+
+inline ExitDump exitDump;
+
+#else
+
+template<typename T>
+class Tracked {};
+
+template<typename T>
+inline void recordAlloc(size_t) {}
+
+template<typename T>
+inline void recordFree(size_t) {}
+
+#define PROF_SCOPE(Type, name) ((void)0)
+
+inline void setSampleEvery(int, long long) {}
+
+inline Snapshot snapshot() {
+    return Snapshot{ 0, {} };
+}
+
+inline void writeReport(std::ostream&) {}
+
+inline void writeFolded(std::ostream&) {}
+
+#endif
+
+}
\ No newline at end of file